@@ -160,6 +160,10 @@ extern void filter_reload_parameters(xmlNode *param_set, const char *restart_str
 
 extern gboolean crm_str_eq(const char *a, const char *b, gboolean use_case);
 
+/* Case-insensitive hashing for tables matching the safe_str_eq() semantics */
+extern guint crm_strcase_hash(gconstpointer v);
+extern gboolean crm_strcase_equal(gconstpointer a, gconstpointer b);
+
 extern gboolean safe_str_neq(const char *a, const char *b);
 extern int crm_parse_int(const char *text, const char *default_text);
 extern long long crm_int_helper(const char *text, char **end_text);
@@ -206,6 +206,10 @@
 #define XML_GRAPH_TAG_RSC_OP		"rsc_op"
 #define XML_GRAPH_TAG_PSEUDO_EVENT	"pseudo_event"
 #define XML_GRAPH_TAG_CRM_EVENT		"crm_event"
+#define XML_GRAPH_ATTR_INPUT_REFS	"refs"
+
+#define XML_TAG_PE_DELTA		"pe_input_delta"
+#define XML_PE_DELTA_BASE		"base"
 
 #define XML_TAG_RULE			"rule"
 #define XML_RULE_ATTR_SCORE		"score"
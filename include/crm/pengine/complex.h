@@ -108,6 +108,8 @@ extern void get_meta_attributes(GHashTable *meta_hash, resource_t *rsc,
 				node_t *node, pe_working_set_t *data_set);
 extern void get_rsc_attributes(GHashTable *meta_hash, resource_t *rsc,
 				node_t *node, pe_working_set_t *data_set);
+extern GHashTable *get_node_rsc_attributes(
+	resource_t *rsc, node_t *node, pe_working_set_t *data_set);
 
 typedef struct resource_alloc_functions_s resource_alloc_functions_t;
 extern resource_t *uber_parent(resource_t *rsc);
@@ -42,6 +42,9 @@ extern gboolean test_rule(xmlNode *rule, GHashTable *node_hash,
 extern gboolean test_expression(xmlNode *expr, GHashTable *node_hash,
 				enum rsc_role_e role, ha_time_t *now);
 
+extern void pe_enable_rule_cache(xmlNode *input);
+extern void pe_flush_rule_cache(void);
+
 extern void unpack_instance_attributes(
 	xmlNode *top, xmlNode *xml_obj, const char *set_name, GHashTable *node_hash,
 	GHashTable *hash, const char *always_first, gboolean overwrite, ha_time_t *now);
@@ -26,6 +26,15 @@ typedef struct node_s node_t;
 typedef struct action_s action_t;
 typedef struct resource_s resource_t;
 
+typedef struct pe_action_index_s 
+{
+		GHashTable *by_key;	/* char* => actions in creation order */
+		GHashTable *by_task;	/* as by_key, resources only */
+} pe_action_index_t;
+
+/* Storage for objects released in bulk by cleanup_calculations() */
+typedef struct pe_arena_s pe_arena_t;
+
 typedef enum no_quorum_policy_e {
 	no_quorum_freeze,
 	no_quorum_stop,
@@ -65,6 +74,7 @@ enum pe_find {
 
 #define pe_flag_start_failure_fatal	0x00001000ULL
 #define pe_flag_remove_after_stop	0x00002000ULL
+#define pe_flag_compact_graph		0x00004000ULL
 
 
 typedef struct pe_working_set_s 
@@ -87,11 +97,20 @@ typedef struct pe_working_set_s
 		
 		GListPtr nodes;
 		GListPtr resources;
+		GHashTable *node_uname_index;	/* char* => node_t* */
+		GHashTable *node_id_index;	/* char* => node_t* */
+		GHashTable *resource_index;	/* char* => GListPtr of resource_t* */
 		GListPtr placement_constraints;
 		GListPtr ordering_constraints;
 		GListPtr colocation_constraints;
+		/* last entries of the three lists above, see constraint_append() */
+		GListPtr placement_tail;
+		GListPtr ordering_tail;
+		GListPtr colocation_tail;
 		
 		GListPtr actions;
+		pe_action_index_t *action_index;
+		GHashTable *action_edges; /* see order_actions() */
 		xmlNode *failed;
 		xmlNode *op_defaults;
 		xmlNode *rsc_defaults;
@@ -105,11 +124,14 @@ typedef struct pe_working_set_s
 		/* final output */
 		xmlNode *graph;
 
+		pe_arena_t *arena;
+
 } pe_working_set_t;
 
 struct node_shared_s { 
 		const char *id; 
 		const char *uname; 
+		int index;		/* stable position assigned by unpack_nodes() */
 		gboolean online;
 		gboolean standby;
 		gboolean standby_onfail;
@@ -123,6 +145,8 @@ struct node_shared_s {
 		GListPtr allocated_rsc;	/* resource_t* */
 		
 		GHashTable *attrs;	/* char* => char* */
+		int attrs_version;	/* bumped whenever attrs is modified */
+		GHashTable *failcounts;	/* "rsc:" prefix => fail_summary_t* */
 		enum node_type type;
 }; 
 
@@ -187,6 +211,7 @@ struct resource_s {
 		GListPtr rsc_cons;         /* rsc_colocation_t* */
 		GListPtr rsc_location;     /* rsc_to_node_t*    */
 		GListPtr actions;	   /* action_t*         */
+		pe_action_index_t *action_index;
 
 		node_t *allocated_to;
 		GListPtr running_on;       /* node_t*   */
@@ -198,6 +223,7 @@ struct resource_s {
 
 		GHashTable *meta;	   
 		GHashTable *parameters;
+		GHashTable *node_parameters; /* node details => per-node parameters */
 
 		GListPtr children;	  /* resource_t* */	
 };
@@ -238,13 +264,20 @@ struct action_s
 
 		GHashTable *meta;
 		GHashTable *extra;
+		GListPtr shared_meta;	/* pe_shared_attrs_t*, dumped after meta */
 		
-		GListPtr actions_before; /* action_warpper_t* */
-		GListPtr actions_after;  /* action_warpper_t* */
+		GPtrArray *actions_before; /* action_warpper_t* */
+		GPtrArray *actions_after;  /* action_warpper_t* */
 };
 
+/* Name/value pairs shared, rather than copied, between many actions */
+typedef struct pe_shared_attrs_s {
+	int refcount;
+	GHashTable *attrs;
+} pe_shared_attrs_t;
+
 typedef struct notify_data_s {
-	GHashTable *keys;
+	pe_shared_attrs_t *keys;
 
 	const char *action;
 	
@@ -270,6 +303,9 @@ extern void cleanup_calculations(pe_working_set_t *data_set);
 extern resource_t *pe_find_resource(GListPtr rsc_list, const char *id_rh);
 extern node_t *pe_find_node(GListPtr node_list, const char *uname);
 extern node_t *pe_find_node_id(GListPtr node_list, const char *id);
+extern resource_t *pe_lookup_resource(pe_working_set_t *data_set, const char *id);
+extern node_t *pe_lookup_node(pe_working_set_t *data_set, const char *uname);
+extern node_t *pe_lookup_node_id(pe_working_set_t *data_set, const char *id);
 extern GListPtr find_operations(
     const char *rsc, const char *node, gboolean active_filter, pe_working_set_t *data_set);
 
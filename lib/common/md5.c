@@ -0,0 +1,185 @@
+/* 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <crm_internal.h>
+#include <string.h>
+#include "md5.h"
+
+#define F(x, y, z) (z ^ (x & (y ^ z)))
+#define G(x, y, z) (y ^ (z & (x ^ y)))
+#define H(x, y, z) (x ^ y ^ z)
+#define I(x, y, z) (y ^ (x | ~z))
+
+#define STEP(f, a, b, c, d, x, t, s) do {			\
+	a += f(b, c, d) + x + t;				\
+	a = (a << s) | (a >> (32 - s));				\
+	a += b;							\
+    } while(0)
+
+static void
+md5_transform(uint32_t state[4], const unsigned char block[64])
+{
+	int lpc = 0;
+	uint32_t x[16];
+	uint32_t a = state[0];
+	uint32_t b = state[1];
+	uint32_t c = state[2];
+	uint32_t d = state[3];
+
+	/* MD5 is defined on little-endian words */
+	for(lpc = 0; lpc < 16; lpc++) {
+		x[lpc] = (uint32_t)block[lpc*4]
+			| ((uint32_t)block[lpc*4+1] << 8)
+			| ((uint32_t)block[lpc*4+2] << 16)
+			| ((uint32_t)block[lpc*4+3] << 24);
+	}
+
+	STEP(F, a, b, c, d, x[ 0], 0xd76aa478,  7);
+	STEP(F, d, a, b, c, x[ 1], 0xe8c7b756, 12);
+	STEP(F, c, d, a, b, x[ 2], 0x242070db, 17);
+	STEP(F, b, c, d, a, x[ 3], 0xc1bdceee, 22);
+	STEP(F, a, b, c, d, x[ 4], 0xf57c0faf,  7);
+	STEP(F, d, a, b, c, x[ 5], 0x4787c62a, 12);
+	STEP(F, c, d, a, b, x[ 6], 0xa8304613, 17);
+	STEP(F, b, c, d, a, x[ 7], 0xfd469501, 22);
+	STEP(F, a, b, c, d, x[ 8], 0x698098d8,  7);
+	STEP(F, d, a, b, c, x[ 9], 0x8b44f7af, 12);
+	STEP(F, c, d, a, b, x[10], 0xffff5bb1, 17);
+	STEP(F, b, c, d, a, x[11], 0x895cd7be, 22);
+	STEP(F, a, b, c, d, x[12], 0x6b901122,  7);
+	STEP(F, d, a, b, c, x[13], 0xfd987193, 12);
+	STEP(F, c, d, a, b, x[14], 0xa679438e, 17);
+	STEP(F, b, c, d, a, x[15], 0x49b40821, 22);
+
+	STEP(G, a, b, c, d, x[ 1], 0xf61e2562,  5);
+	STEP(G, d, a, b, c, x[ 6], 0xc040b340,  9);
+	STEP(G, c, d, a, b, x[11], 0x265e5a51, 14);
+	STEP(G, b, c, d, a, x[ 0], 0xe9b6c7aa, 20);
+	STEP(G, a, b, c, d, x[ 5], 0xd62f105d,  5);
+	STEP(G, d, a, b, c, x[10], 0x02441453,  9);
+	STEP(G, c, d, a, b, x[15], 0xd8a1e681, 14);
+	STEP(G, b, c, d, a, x[ 4], 0xe7d3fbc8, 20);
+	STEP(G, a, b, c, d, x[ 9], 0x21e1cde6,  5);
+	STEP(G, d, a, b, c, x[14], 0xc33707d6,  9);
+	STEP(G, c, d, a, b, x[ 3], 0xf4d50d87, 14);
+	STEP(G, b, c, d, a, x[ 8], 0x455a14ed, 20);
+	STEP(G, a, b, c, d, x[13], 0xa9e3e905,  5);
+	STEP(G, d, a, b, c, x[ 2], 0xfcefa3f8,  9);
+	STEP(G, c, d, a, b, x[ 7], 0x676f02d9, 14);
+	STEP(G, b, c, d, a, x[12], 0x8d2a4c8a, 20);
+
+	STEP(H, a, b, c, d, x[ 5], 0xfffa3942,  4);
+	STEP(H, d, a, b, c, x[ 8], 0x8771f681, 11);
+	STEP(H, c, d, a, b, x[11], 0x6d9d6122, 16);
+	STEP(H, b, c, d, a, x[14], 0xfde5380c, 23);
+	STEP(H, a, b, c, d, x[ 1], 0xa4beea44,  4);
+	STEP(H, d, a, b, c, x[ 4], 0x4bdecfa9, 11);
+	STEP(H, c, d, a, b, x[ 7], 0xf6bb4b60, 16);
+	STEP(H, b, c, d, a, x[10], 0xbebfbc70, 23);
+	STEP(H, a, b, c, d, x[13], 0x289b7ec6,  4);
+	STEP(H, d, a, b, c, x[ 0], 0xeaa127fa, 11);
+	STEP(H, c, d, a, b, x[ 3], 0xd4ef3085, 16);
+	STEP(H, b, c, d, a, x[ 6], 0x04881d05, 23);
+	STEP(H, a, b, c, d, x[ 9], 0xd9d4d039,  4);
+	STEP(H, d, a, b, c, x[12], 0xe6db99e5, 11);
+	STEP(H, c, d, a, b, x[15], 0x1fa27cf8, 16);
+	STEP(H, b, c, d, a, x[ 2], 0xc4ac5665, 23);
+
+	STEP(I, a, b, c, d, x[ 0], 0xf4292244,  6);
+	STEP(I, d, a, b, c, x[ 7], 0x432aff97, 10);
+	STEP(I, c, d, a, b, x[14], 0xab9423a7, 15);
+	STEP(I, b, c, d, a, x[ 5], 0xfc93a039, 21);
+	STEP(I, a, b, c, d, x[12], 0x655b59c3,  6);
+	STEP(I, d, a, b, c, x[ 3], 0x8f0ccc92, 10);
+	STEP(I, c, d, a, b, x[10], 0xffeff47d, 15);
+	STEP(I, b, c, d, a, x[ 1], 0x85845dd1, 21);
+	STEP(I, a, b, c, d, x[ 8], 0x6fa87e4f,  6);
+	STEP(I, d, a, b, c, x[15], 0xfe2ce6e0, 10);
+	STEP(I, c, d, a, b, x[ 6], 0xa3014314, 15);
+	STEP(I, b, c, d, a, x[13], 0x4e0811a1, 21);
+	STEP(I, a, b, c, d, x[ 4], 0xf7537e82,  6);
+	STEP(I, d, a, b, c, x[11], 0xbd3af235, 10);
+	STEP(I, c, d, a, b, x[ 2], 0x2ad7d2bb, 15);
+	STEP(I, b, c, d, a, x[ 9], 0xeb86d391, 21);
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+void
+crm_md5_init(crm_md5_t *ctx)
+{
+	ctx->state[0] = 0x67452301;
+	ctx->state[1] = 0xefcdab89;
+	ctx->state[2] = 0x98badcfe;
+	ctx->state[3] = 0x10325476;
+	ctx->length = 0;
+}
+
+void
+crm_md5_update(crm_md5_t *ctx, const void *data, size_t len)
+{
+	const unsigned char *input = data;
+	size_t used = ctx->length % 64;
+
+	ctx->length += len;
+
+	if(used > 0) {
+		size_t fill = 64 - used;
+		if(len < fill) {
+			memcpy(ctx->block + used, input, len);
+			return;
+		}
+		memcpy(ctx->block + used, input, fill);
+		md5_transform(ctx->state, ctx->block);
+		input += fill;
+		len -= fill;
+	}
+
+	while(len >= 64) {
+		md5_transform(ctx->state, input);
+		input += 64;
+		len -= 64;
+	}
+
+	memcpy(ctx->block, input, len);
+}
+
+void
+crm_md5_final(crm_md5_t *ctx, unsigned char digest[16])
+{
+	int lpc = 0;
+	unsigned char trailer[72];
+	uint64_t bits = ctx->length * 8;
+	size_t used = ctx->length % 64;
+	size_t pad = (used < 56) ? (56 - used) : (120 - used);
+
+	memset(trailer, 0, sizeof(trailer));
+	trailer[0] = 0x80;
+	for(lpc = 0; lpc < 8; lpc++) {
+		trailer[pad + lpc] = (unsigned char)(bits >> (8 * lpc));
+	}
+	crm_md5_update(ctx, trailer, pad + 8);
+
+	for(lpc = 0; lpc < 4; lpc++) {
+		digest[lpc*4]   = (unsigned char)(ctx->state[lpc]);
+		digest[lpc*4+1] = (unsigned char)(ctx->state[lpc] >> 8);
+		digest[lpc*4+2] = (unsigned char)(ctx->state[lpc] >> 16);
+		digest[lpc*4+3] = (unsigned char)(ctx->state[lpc] >> 24);
+	}
+}
@@ -0,0 +1,38 @@
+/* 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef CRM_COMMON_MD5__H
+#define CRM_COMMON_MD5__H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Incremental MD5 (RFC 1321)
+ *
+ * clplumbing only exports a one-shot MD5(), which forces callers to
+ * assemble the whole input in memory first.
+ */
+typedef struct crm_md5_s 
+{
+	uint32_t state[4];
+	uint64_t length;	/* bytes hashed so far */
+	unsigned char block[64];
+} crm_md5_t;
+
+extern void crm_md5_init(crm_md5_t *ctx);
+extern void crm_md5_update(crm_md5_t *ctx, const void *data, size_t len);
+extern void crm_md5_final(crm_md5_t *ctx, unsigned char digest[16]);
+
+#endif
@@ -1870,6 +1870,22 @@ gboolean crm_str_eq(const char *a, const char *b, gboolean use_case)
     return FALSE;
 }
 
+guint crm_strcase_hash(gconstpointer v)
+{
+    const unsigned char *p = v;
+    guint32 h = 5381;
+
+    for(; *p != '\0'; p++) {
+	h = (h << 5) + h + tolower(*p);
+    }
+    return h;
+}
+
+gboolean crm_strcase_equal(gconstpointer a, gconstpointer b)
+{
+    return crm_str_eq(a, b, FALSE);
+}
+
 char *crm_meta_name(const char *field) 
 {
     int lpc = 0;
@@ -35,12 +35,14 @@
 #include <libxml/xmlreader.h>
 
 #include <clplumbing/md5.h>
+#include "md5.h"
 #if HAVE_BZLIB_H
 #  include <bzlib.h>
 #endif
 
 #define XML_BUFFER_SIZE	4096
 #define XML_PARSER_DEBUG 0
+#define XML_MAX_DELTA_CHAIN 100
 
 xmlDoc *getDocPtr(xmlNode *node);
 
@@ -635,6 +637,59 @@ static void strip_text_nodes(xmlNode *xml)
     }
 }
 
+/* A saved PE input may only be the changes since the one before it,
+ * which is looked for in the same directory
+ */
+static xmlNode *
+expand_pe_delta(const char *filename, xmlNode *delta)
+{
+    static int depth = 0;
+    int dir_len = 0;
+    char *base_file = NULL;
+    xmlNode *base = NULL;
+    xmlNode *result = NULL;
+    xmlNode *diff = find_xml_node(delta, "diff", FALSE);
+    const char *base_name = crm_element_value(delta, XML_PE_DELTA_BASE);
+
+    if(filename == NULL) {
+	crm_err("PE input deltas can only be read from a file");
+	goto done;
+    }
+    
+    CRM_CHECK(base_name != NULL && diff != NULL, goto done);
+    if(depth >= XML_MAX_DELTA_CHAIN) {
+	crm_err("Gave up on %s: more than %d deltas since the last full input",
+		filename, XML_MAX_DELTA_CHAIN);
+	goto done;
+    }
+
+    if(strchr(base_name, '/') == NULL && strrchr(filename, '/') != NULL) {
+	dir_len = strrchr(filename, '/') - filename + 1;
+    }
+    crm_malloc0(base_file, dir_len + strlen(base_name) + 1);
+    strncpy(base_file, filename, dir_len);
+    strcat(base_file, base_name);
+    
+    depth++;
+    base = filename2xml(base_file);
+    depth--;
+
+    if(base == NULL) {
+	crm_err("Could not read %s, needed by %s", base_file, filename);
+
+    } else if(apply_xml_diff(base, diff, &result) == FALSE) {
+	crm_err("%s no longer applies to %s", filename, base_file);
+	free_xml(result);
+	result = NULL;
+    }
+    
+  done:
+    crm_free(base_file);
+    free_xml(base);
+    free_xml(delta);
+    return result;
+}
+
 xmlNode *
 filename2xml(const char *filename)
 {
@@ -696,6 +751,10 @@ filename2xml(const char *filename)
     }
     
     xmlFreeParserCtxt(ctxt);
+
+    if(xml != NULL && safe_str_eq(crm_element_name(xml), XML_TAG_PE_DELTA)) {
+	xml = expand_pe_delta(filename, xml);
+    }
     return xml;
 }
 
@@ -2091,6 +2150,164 @@ filter_xml(xmlNode *data, const char **filter, int filter_len, gboolean recursiv
     xml_child_iter(data, child, filter_xml(child, filter, filter_len, recursive));
 }
 
+/* Feed the serialized form of an element straight into an MD5 context
+ *
+ * This produces the same bytes xmlNodeDump() would for the sorted (or
+ * copied) tree calculate_xml_digest() used to build, without building it.
+ * Anything the simple serializer below cannot reproduce exactly
+ * (namespaces, entity references, non-ASCII or control characters, text
+ * and comments in an unsorted tree) makes it return FALSE, in which case
+ * the caller falls back to the old method.
+ */
+#define MAX_DIGEST_ATTRS 32
+
+static gboolean
+digest_xml_value(crm_md5_t *md5, const char *value)
+{
+	const char *start = value;
+	const char *lpc = value;
+	const char *entity = NULL;
+
+	for(; *lpc != 0; lpc++) {
+		unsigned char c = *lpc;
+		switch(c) {
+			case '<':  entity = "&lt;";   break;
+			case '>':  entity = "&gt;";   break;
+			case '&':  entity = "&amp;";  break;
+			case '"':  entity = "&quot;"; break;
+			case '\n': entity = "&#10;";  break;
+			case '\r': entity = "&#13;";  break;
+			case '\t': entity = "&#9;";   break;
+			default:
+				if(c < 0x20 || c >= 0x80) {
+					return FALSE;
+				}
+				continue;
+		}
+		crm_md5_update(md5, start, lpc - start);
+		crm_md5_update(md5, entity, strlen(entity));
+		start = lpc + 1;
+	}
+	crm_md5_update(md5, start, lpc - start);
+	return TRUE;
+}
+
+static gboolean
+digest_filtered(const char *name, gboolean do_filter)
+{
+	int lpc = 0;
+	if(do_filter == FALSE) {
+		return FALSE;
+	}
+	for(lpc = 0; lpc < DIMOF(filter); lpc++) {
+		if(strcmp(name, filter[lpc]) == 0) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+digest_xml_element(crm_md5_t *md5, xmlNode *xml, gboolean sort, gboolean do_filter)
+{
+	int lpc = 0;
+	int num_attrs = 0;
+	gboolean has_children = FALSE;
+	xmlAttr *attrs[MAX_DIGEST_ATTRS];
+	xmlAttr *prop = NULL;
+	xmlNode *child = NULL;
+	const char *name = (const char *)xml->name;
+
+	if(name == NULL || xml->ns != NULL) {
+		return FALSE;
+	}
+
+	for(prop = xml->properties; prop != NULL; prop = prop->next) {
+		if(num_attrs == MAX_DIGEST_ATTRS
+		   || prop->ns != NULL || prop->name == NULL
+		   || prop->children == NULL
+		   || prop->children->type != XML_TEXT_NODE
+		   || prop->children->next != NULL
+		   || prop->children->content == NULL) {
+			return FALSE;
+
+		} else if(digest_filtered((const char *)prop->name, do_filter)) {
+			continue;
+		}
+
+		/* Insertion sort - elements rarely have more than a handful */
+		lpc = num_attrs++;
+		if(sort) {
+			for(; lpc > 0; lpc--) {
+				if(strcmp((const char *)attrs[lpc-1]->name,
+					  (const char *)prop->name) <= 0) {
+					break;
+				}
+				attrs[lpc] = attrs[lpc-1];
+			}
+		}
+		attrs[lpc] = prop;
+	}
+
+	for(child = xml->children; child != NULL; child = child->next) {
+		if(child->type == XML_ELEMENT_NODE) {
+			has_children = TRUE;
+
+		} else if(sort == FALSE && do_filter == FALSE) {
+			/* copy_xml() would have kept it */
+			return FALSE;
+		}
+	}
+
+	crm_md5_update(md5, "<", 1);
+	crm_md5_update(md5, name, strlen(name));
+	for(lpc = 0; lpc < num_attrs; lpc++) {
+		const char *p_name = (const char *)attrs[lpc]->name;
+		crm_md5_update(md5, " ", 1);
+		crm_md5_update(md5, p_name, strlen(p_name));
+		crm_md5_update(md5, "=\"", 2);
+		if(digest_xml_value(
+			   md5, (const char *)attrs[lpc]->children->content) == FALSE) {
+			return FALSE;
+		}
+		crm_md5_update(md5, "\"", 1);
+	}
+
+	if(has_children == FALSE) {
+		crm_md5_update(md5, "/>", 2);
+		return TRUE;
+	}
+
+	crm_md5_update(md5, ">", 1);
+	for(child = xml->children; child != NULL; child = child->next) {
+		if(child->type == XML_ELEMENT_NODE
+		   && digest_xml_element(md5, child, sort, do_filter) == FALSE) {
+			return FALSE;
+		}
+	}
+	crm_md5_update(md5, "</", 2);
+	crm_md5_update(md5, name, strlen(name));
+	crm_md5_update(md5, ">", 1);
+	return TRUE;
+}
+
+static gboolean
+stream_xml_digest(xmlNode *input, gboolean sort, gboolean do_filter,
+		  unsigned char *raw_digest)
+{
+	crm_md5_t md5;
+
+	/* Matches the " %s\n" wrapping dump_xml() applies for digests */
+	crm_md5_init(&md5);
+	crm_md5_update(&md5, " ", 1);
+	if(digest_xml_element(&md5, input, sort || do_filter, do_filter) == FALSE) {
+		return FALSE;
+	}
+	crm_md5_update(&md5, "\n", 1);
+	crm_md5_final(&md5, raw_digest);
+	return TRUE;
+}
+
 /* "c048eae664dba840e1d2060f00299e9d" */
 char *
 calculate_xml_digest(xmlNode *input, gboolean sort, gboolean do_filter)
@@ -2103,6 +2320,15 @@ calculate_xml_digest(xmlNode *input, gboolean sort, gboolean do_filter)
 	char *buffer = NULL;
 	size_t buffer_len = 0;
 
+	CRM_CHECK(input != NULL, return NULL);
+	crm_malloc(raw_digest, (digest_len + 1));
+
+	/* The old method is still needed to log what was digested */
+	if(crm_log_level < LOG_DEBUG_2
+	   && stream_xml_digest(input, sort, do_filter, raw_digest)) {
+		goto done;
+	}
+	
 	if(sort || do_filter) {
 	    sorted = sorted_xml(input, NULL, TRUE);
 	} else {
@@ -2116,17 +2342,21 @@ calculate_xml_digest(xmlNode *input, gboolean sort, gboolean do_filter)
 	buffer = dump_xml(sorted, FALSE, TRUE);
 	buffer_len = strlen(buffer);
 	
-	CRM_CHECK(buffer != NULL && buffer_len > 0, free_xml(sorted); crm_free(buffer); return NULL);
+	CRM_CHECK(buffer != NULL && buffer_len > 0,
+		  free_xml(sorted); crm_free(buffer); crm_free(raw_digest); return NULL);
 
-	crm_malloc(digest, (2 * digest_len + 1));
-	crm_malloc(raw_digest, (digest_len + 1));
 	MD5((unsigned char *)buffer, buffer_len, raw_digest);
+	
+  done:
+	crm_malloc(digest, (2 * digest_len + 1));
 	for(i = 0; i < digest_len; i++) {
  		sprintf(digest+(2*i), "%02x", raw_digest[i]);
  	}
 	digest[(2*digest_len)] = 0;
-	crm_debug_2("Digest %s: %s\n", digest, buffer);
-	crm_log_xml(LOG_DEBUG_3,  "digest:source", sorted);
+	if(buffer != NULL) {
+		crm_debug_2("Digest %s: %s\n", digest, buffer);
+		crm_log_xml(LOG_DEBUG_3,  "digest:source", sorted);
+	}
 	crm_free(buffer);
 	crm_free(raw_digest);
 	free_xml(sorted);
@@ -106,6 +106,7 @@ create_child_clone(resource_t *rsc, int sub_id, pe_working_set_t *data_set)
 	clone_data->total_clones += 1;
 	crm_debug_2("Setting clone attributes for: %s", child_rsc->id);
 	rsc->children = g_list_append(rsc->children, child_rsc);
+	pe_index_resource(child_rsc, data_set);
 	if(as_orphan) {
 	    mark_as_orphan(child_rsc);
 	}
@@ -111,6 +111,9 @@ pe_cluster_option pe_opts[] = {
 	{ "batch-limit", NULL, "integer", NULL, "30", &check_number,
 	  "The number of jobs that the TE is allowed to execute in parallel",
 	  "The \"correct\" value will depend on the speed and load of your network and cluster nodes." },
+	{ "compact-transition-graph", NULL, "boolean", NULL, "false", &check_boolean,
+	  "Refer to a synapse's inputs by id only",
+	  "The TE looks the rest up in the graph, which makes large transitions considerably smaller to send and unpack." },
 	{ "default-action-timeout", "default_action_timeout", "time", NULL, "20s", &check_time,
 	  "How long to wait for actions to complete", NULL },
 
@@ -133,6 +136,12 @@ pe_cluster_option pe_opts[] = {
 	  "The number of PE inputs resulting in WARNINGs to save", "Zero to disable, -1 to store unlimited." },
 	{ "pe-input-series-max", NULL, "integer", NULL, "4000", &check_number,
 	  "The number of other PE inputs to save", "Zero to disable, -1 to store unlimited." },
+	{ "pe-input-compression", NULL, "integer", NULL, "5", &check_number,
+	  "The bzip2 block size used when saving PE inputs", "One to nine, zero saves them uncompressed." },
+	{ "pe-input-keyframe-interval", NULL, "integer", NULL, "0", &check_number,
+	  "Save only every Nth PE input in full", "The others only record what changed since the previous input.  Zero or one saves every input in full, at most 100." },
+	{ "pe-input-async-write", NULL, "boolean", NULL, "true", &check_boolean,
+	  "Save PE inputs in the background", "Replies to the DC are no longer held up by compressing and syncing the input to disk." },
 
 	/* Node health */
 	{ "node-health-strategy", NULL, "enum", "none, migrate-on-red, only-green, progressive, custom", "none", &check_health,
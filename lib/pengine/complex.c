@@ -165,6 +165,60 @@ get_rsc_attributes(GHashTable *meta_hash, resource_t *rsc,
     }
 }
 
+typedef struct node_params_s 
+{
+	int attrs_version;
+	GHashTable *params;
+} node_params_t;
+
+static void
+free_node_params(gpointer data)
+{
+	node_params_t *entry = data;
+	g_hash_table_destroy(entry->params);
+	crm_free(entry);
+}
+
+/* Memoized get_rsc_attributes()
+ *
+ * The result belongs to the resource and is shared between callers:
+ *   it must not be modified or free'd.  It is rebuilt if the node's
+ *   attributes have changed since it was calculated.
+ */
+GHashTable *
+get_node_rsc_attributes(
+	resource_t *rsc, node_t *node, pe_working_set_t *data_set)
+{
+	int attrs_version = 0;
+	node_params_t *entry = NULL;
+	struct node_shared_s *details = NULL;
+
+	if(node != NULL) {
+		details = node->details;
+		attrs_version = details->attrs_version;
+	}
+
+	if(rsc->node_parameters == NULL) {
+		rsc->node_parameters = g_hash_table_new_full(
+			g_direct_hash, g_direct_equal, NULL, free_node_params);
+	}
+
+	entry = g_hash_table_lookup(rsc->node_parameters, details);
+	if(entry != NULL && entry->attrs_version == attrs_version) {
+		return entry->params;
+	}
+
+	crm_malloc0(entry, sizeof(node_params_t));
+	entry->attrs_version = attrs_version;
+	entry->params = g_hash_table_new_full(
+		g_str_hash, g_str_equal,
+		g_hash_destroy_str, g_hash_destroy_str);
+	get_rsc_attributes(entry->params, rsc, node, data_set);
+
+	g_hash_table_replace(rsc->node_parameters, details, entry);
+	return entry->params;
+}
+
 gboolean	
 common_unpack(xmlNode * xml_obj, resource_t **rsc,
 	      resource_t *parent, pe_working_set_t *data_set)
@@ -236,6 +290,7 @@ common_unpack(xmlNode * xml_obj, resource_t **rsc,
 
 	(*rsc)->rsc_cons	   = NULL; 
 	(*rsc)->actions            = NULL;
+	(*rsc)->action_index       = NULL;
 	(*rsc)->role		   = RSC_ROLE_STOPPED;
 	(*rsc)->next_role	   = RSC_ROLE_UNKNOWN;
 
@@ -451,6 +506,9 @@ void common_free(resource_t *rsc)
 	if(rsc->parameters != NULL) {
 		g_hash_table_destroy(rsc->parameters);
 	}
+	if(rsc->node_parameters != NULL) {
+		g_hash_table_destroy(rsc->node_parameters);
+	}
 	if(rsc->meta != NULL) {
 		g_hash_table_destroy(rsc->meta);
 	}
@@ -469,6 +527,8 @@ void common_free(resource_t *rsc)
 		g_list_free(rsc->actions);
 		rsc->actions = NULL;
 	}
+	pe_free_action_index(rsc->action_index);
+	rsc->action_index = NULL;
 	pe_free_shallow_adv(rsc->rsc_location, FALSE);
 	pe_free_shallow_adv(rsc->allowed_nodes, TRUE);
 	crm_free(rsc->id);
@@ -207,7 +207,6 @@ native_parameter(
 	char *value_copy = NULL;
 	const char *value = NULL;
 	GHashTable *hash = rsc->parameters;
-	GHashTable *local_hash = NULL;
 
 	CRM_CHECK(rsc != NULL, return NULL);
 	CRM_CHECK(name != NULL && strlen(name) != 0, return NULL);
@@ -221,14 +220,7 @@ native_parameter(
 		} else {
 			crm_debug_2("Creating default hash");
 		}
-		
-		local_hash = g_hash_table_new_full(
-			g_str_hash, g_str_equal,
-			g_hash_destroy_str, g_hash_destroy_str);
-
-		get_rsc_attributes(local_hash, rsc, node, data_set);
-
-		hash = local_hash;
+		hash = get_node_rsc_attributes(rsc, node, data_set);
 	}
 		
 	value = g_hash_table_lookup(hash, name);
@@ -240,9 +232,6 @@ native_parameter(
 	if(value != NULL) {
 		value_copy = crm_strdup(value);
 	}
-	if(local_hash != NULL) {
-		g_hash_table_destroy(local_hash);
-	}
 	return value_copy;
 }
 
@@ -26,83 +26,492 @@
 #include <crm/pengine/rules.h>
 
 ha_time_t *parse_xml_duration(ha_time_t *start, xmlNode *duration_spec);
-
-gboolean test_date_expression(xmlNode *time_expr, ha_time_t *now);
 gboolean cron_range_satisfied(ha_time_t *now, xmlNode *cron_spec);
-gboolean test_attr_expression(
-	xmlNode *expr, GHashTable *hash, ha_time_t *now);
-gboolean test_role_expression(
-	xmlNode *expr, enum rsc_role_e role, ha_time_t *now);
 
-gboolean
-test_ruleset(xmlNode *ruleset, GHashTable *node_hash, ha_time_t *now) 
+/* Rules are compiled once per working set
+ *
+ * Evaluating a rule against every node used to re-read its XML, re-match
+ * its operators and re-parse its constants (and dates) each time.  Rules
+ * from the document registered with pe_enable_rule_cache() are compiled
+ * on first use and kept until the cache is flushed.  Rules from any other
+ * document are compiled, evaluated and thrown away.
+ */
+enum expr_op {
+	expr_op_unknown,
+	expr_op_defined,
+	expr_op_not_defined,
+	expr_op_eq,
+	expr_op_ne,
+	expr_op_lt,
+	expr_op_lte,
+	expr_op_gt,
+	expr_op_gte,
+};
+
+enum expr_cmp {
+	expr_cmp_none,
+	expr_cmp_string,
+	expr_cmp_number,
+	expr_cmp_version,
+};
+
+enum date_op {
+	date_op_unknown,
+	date_op_in_range,
+	date_op_date_spec,
+	date_op_gt,
+	date_op_lt,
+	date_op_eq,
+	date_op_neq,
+};
+
+typedef struct compiled_rule_s compiled_rule_t;
+
+typedef struct compiled_expr_s 
 {
-	gboolean ruleset_default = TRUE;
-	xml_child_iter_filter(
-		ruleset, rule, XML_TAG_RULE,
+	enum expression_type type;
+	const char *id;
+
+	/* nested_rule */
+	compiled_rule_t *rule;
+
+	/* attr_expr, loc_expr and role_expr */
+	const char *attr;
+	const char *op_text;
+	const char *value;
+	const char *type_text;
+	gboolean type_defaulted;
+	enum expr_op op;
+	enum expr_cmp cmp;
+	int value_i;
+	enum rsc_role_e role;
+	
+	/* time_expr */
+	enum date_op date_op;
+	ha_time_t *start;
+	ha_time_t *end;
+	xmlNode *date_spec;
+} compiled_expr_t;
+
+struct compiled_rule_s 
+{
+	const char *id;
+	gboolean do_and;
+	GListPtr exprs;	/* compiled_expr_t* */
+};
 
-		ruleset_default = FALSE;
-		if(test_rule(rule, node_hash, RSC_ROLE_UNKNOWN, now)) {
-			return TRUE;
+static xmlDoc *rule_cache_doc = NULL;
+static GHashTable *rule_cache = NULL;	/* xmlNode* => compiled_rule_t* */
+
+static compiled_rule_t *compile_rule(xmlNode *rule);
+
+static enum expr_op
+text2expr_op(const char *op)
+{
+	if(safe_str_eq(op, "defined")) {
+		return expr_op_defined;
+	} else if(safe_str_eq(op, "not_defined")) {
+		return expr_op_not_defined;
+	} else if(safe_str_eq(op, "eq")) {
+		return expr_op_eq;
+	} else if(safe_str_eq(op, "ne")) {
+		return expr_op_ne;
+	} else if(safe_str_eq(op, "lt")) {
+		return expr_op_lt;
+	} else if(safe_str_eq(op, "lte")) {
+		return expr_op_lte;
+	} else if(safe_str_eq(op, "gt")) {
+		return expr_op_gt;
+	} else if(safe_str_eq(op, "gte")) {
+		return expr_op_gte;
+	}
+	return expr_op_unknown;
+}
+
+static enum date_op
+text2date_op(const char *op)
+{
+	if(op == NULL || safe_str_eq(op, "in_range")) {
+		return date_op_in_range;
+	} else if(safe_str_eq(op, "date_spec")) {
+		return date_op_date_spec;
+	} else if(safe_str_eq(op, "gt")) {
+		return date_op_gt;
+	} else if(safe_str_eq(op, "lt")) {
+		return date_op_lt;
+	} else if(safe_str_eq(op, "eq")) {
+		return date_op_eq;
+	} else if(safe_str_eq(op, "neq")) {
+		return date_op_neq;
+	}
+	return date_op_unknown;
+}
+
+static ha_time_t *
+compile_date(xmlNode *time_expr, const char *field)
+{
+	ha_time_t *result = NULL;
+	const char *value = crm_element_value(time_expr, field);
+	if(value != NULL) {
+		char *value_copy = crm_strdup(value);
+		char *value_copy_start = value_copy;
+		result = parse_date(&value_copy);
+		crm_free(value_copy_start);
+	}
+	return result;
+}
+
+static void
+compile_attr_expression(compiled_expr_t *compiled, xmlNode *expr)
+{
+	compiled->attr      = crm_element_value(expr, XML_EXPR_ATTR_ATTRIBUTE);
+	compiled->op_text   = crm_element_value(expr, XML_EXPR_ATTR_OPERATION);
+	compiled->value     = crm_element_value(expr, XML_EXPR_ATTR_VALUE);
+	compiled->type_text = crm_element_value(expr, XML_EXPR_ATTR_TYPE);
+	compiled->op = text2expr_op(compiled->op_text);
+
+	if(compiled->type_text == NULL) {
+		compiled->type_defaulted = TRUE;
+		switch(compiled->op) {
+			case expr_op_lt:
+			case expr_op_lte:
+			case expr_op_gt:
+			case expr_op_gte:
+				compiled->type_text = "number";
+				break;
+			default:
+				compiled->type_text = "string";
+				break;
 		}
-		);
-	
-	return ruleset_default;
+	}
+
+	if(safe_str_eq(compiled->type_text, "string")) {
+		compiled->cmp = expr_cmp_string;
+		
+	} else if(safe_str_eq(compiled->type_text, "number")) {
+		compiled->cmp = expr_cmp_number;
+		if(compiled->value != NULL) {
+			compiled->value_i = crm_parse_int(compiled->value, NULL);
+		}
+		
+	} else if(safe_str_eq(compiled->type_text, "version")) {
+		compiled->cmp = expr_cmp_version;
+	}
 }
 
-gboolean
-test_rule(xmlNode *rule, GHashTable *node_hash, enum rsc_role_e role,
-	  ha_time_t *now) 
+static compiled_expr_t *
+compile_expression(xmlNode *expr)
 {
-	gboolean test = TRUE;
-	gboolean empty = TRUE;
-	gboolean passed = TRUE;
-	gboolean do_and = TRUE;
-	const char *value = NULL;
+	compiled_expr_t *compiled = NULL;
+
+	crm_malloc0(compiled, sizeof(compiled_expr_t));
+	compiled->id = ID(expr);
+	compiled->type = find_expression_type(expr);
+
+	switch(compiled->type) {
+		case nested_rule:
+			compiled->rule = compile_rule(expr);
+			break;
+			
+		case attr_expr:
+		case loc_expr:
+			compile_attr_expression(compiled, expr);
+			break;
+
+		case role_expr:
+			compiled->op_text = crm_element_value(expr, XML_EXPR_ATTR_OPERATION);
+			compiled->value   = crm_element_value(expr, XML_EXPR_ATTR_VALUE);
+			compiled->op = text2expr_op(compiled->op_text);
+			if(compiled->op == expr_op_eq || compiled->op == expr_op_ne) {
+				compiled->role = text2role(compiled->value);
+			}
+			break;
+
+		case time_expr:
+			compiled->date_op = text2date_op(
+				crm_element_value(expr, "operation"));
+			compiled->date_spec = first_named_child(expr, "date_spec");
+			compiled->start = compile_date(expr, "start");
+			compiled->end = compile_date(expr, "end");
+			if(compiled->start != NULL && compiled->end == NULL) {
+				xmlNode *duration_spec = first_named_child(expr, "duration");
+				if(duration_spec != NULL) {
+					compiled->end = parse_xml_duration(
+						compiled->start, duration_spec);
+				}
+			}
+			break;
+
+		default:
+			break;
+	}
+	return compiled;
+}
+
+static compiled_rule_t *
+compile_rule(xmlNode *rule)
+{
+	compiled_rule_t *compiled = NULL;
 
 	rule = expand_idref(rule, NULL);
-	value = crm_element_value(rule, XML_RULE_ATTR_BOOLEAN_OP);
-	if(safe_str_eq(value, "or")) {
-		do_and = FALSE;
-		passed = FALSE;
+	crm_malloc0(compiled, sizeof(compiled_rule_t));
+	compiled->id = ID(rule);
+	compiled->do_and = TRUE;
+	if(safe_str_eq(crm_element_value(rule, XML_RULE_ATTR_BOOLEAN_OP), "or")) {
+		compiled->do_and = FALSE;
 	}
 
-	crm_debug_2("Testing rule %s", ID(rule));
 	xml_child_iter(
 		rule, expr, 
-		test = test_expression(expr, node_hash, role, now);
-		empty = FALSE;
+		compiled->exprs = g_list_append(
+			compiled->exprs, compile_expression(expr));
+		);
+	return compiled;
+}
+
+static void free_compiled_rule(gpointer data);
+
+static void
+free_compiled_expression(compiled_expr_t *compiled)
+{
+	if(compiled == NULL) {
+		return;
+	}
+	free_compiled_rule(compiled->rule);
+	free_ha_date(compiled->start);
+	free_ha_date(compiled->end);
+	crm_free(compiled);
+}
+
+static void
+free_compiled_rule(gpointer data)
+{
+	compiled_rule_t *compiled = data;
+	if(compiled == NULL) {
+		return;
+	}
+	slist_destroy(compiled_expr_t, expr, compiled->exprs,
+		      free_compiled_expression(expr));
+	crm_free(compiled);
+}
+
+/* Rules from this document may be compiled once and re-used until the
+ * next call (or pe_flush_rule_cache())
+ */
+void
+pe_enable_rule_cache(xmlNode *input)
+{
+	pe_flush_rule_cache();
+	if(input != NULL) {
+		rule_cache_doc = input->doc;
+		rule_cache = g_hash_table_new_full(
+			g_direct_hash, g_direct_equal, NULL, free_compiled_rule);
+	}
+}
+
+void
+pe_flush_rule_cache(void)
+{
+	if(rule_cache != NULL) {
+		g_hash_table_destroy(rule_cache);
+		rule_cache = NULL;
+	}
+	rule_cache_doc = NULL;
+}
+
+static gboolean eval_rule(compiled_rule_t *rule, GHashTable *node_hash,
+			  enum rsc_role_e role, ha_time_t *now);
+
+static gboolean
+eval_role_expression(compiled_expr_t *expr, enum rsc_role_e role)
+{
+	gboolean accept = FALSE;
+
+	if(role == RSC_ROLE_UNKNOWN) {
+		return accept;
+	}
+
+	switch(expr->op) {
+		case expr_op_defined:
+			if(role > RSC_ROLE_STARTED) {
+				accept = TRUE;
+			}
+			break;
+		case expr_op_not_defined:
+			if(role < RSC_ROLE_SLAVE && role > RSC_ROLE_UNKNOWN) {
+				accept = TRUE;
+			}
+			break;
+		case expr_op_eq:
+			if(expr->role == role) {
+				accept = TRUE;
+			}
+			break;
+		case expr_op_ne:
+			/* we will only test "ne" wtih master/slave roles style */
+			if(role < RSC_ROLE_SLAVE && role > RSC_ROLE_UNKNOWN) {
+				accept = FALSE;
+				
+			} else if(expr->role != role) {
+				accept = TRUE;
+			}
+			break;
+		default:
+			break;
+	}
+	return accept;
+}
+
+static gboolean
+eval_attr_expression(compiled_expr_t *expr, GHashTable *hash)
+{
+	int cmp = 0;
+	gboolean accept = FALSE;
+	const char *h_val = NULL;
+	const char *value = expr->value;
+	
+	if(expr->attr == NULL || expr->op_text == NULL) {
+		pe_err("Invlaid attribute or operation in expression"
+			" (\'%s\' \'%s\' \'%s\')",
+			crm_str(expr->attr), crm_str(expr->op_text), crm_str(value));
+		return FALSE;
+	}
+
+	if(hash != NULL) {
+		h_val = (const char*)g_hash_table_lookup(hash, expr->attr);
+	}
+	
+	if(value != NULL && h_val != NULL) {
+		if(expr->type_defaulted) {
+		    crm_debug_2("Defaulting to %s based comparison for '%s' op",
+				expr->type_text, expr->op_text);
+		}
 		
-		if(test && do_and == FALSE) {
-			crm_debug_3("Expression %s/%s passed",
-				    ID(rule), ID(expr));
-			return TRUE;
-			
-		} else if(test == FALSE && do_and) {
-			crm_debug_3("Expression %s/%s failed",
-				    ID(rule), ID(expr));
-			return FALSE;
+		switch(expr->cmp) {
+			case expr_cmp_string:
+				cmp = strcasecmp(h_val, value);
+				break;
+				
+			case expr_cmp_number: {
+				int h_val_f = crm_parse_int(h_val, NULL);
+				if(h_val_f < expr->value_i) {
+					cmp = -1;
+				} else if(h_val_f > expr->value_i)  {
+					cmp = 1;
+				} else {
+					cmp = 0;
+				}
+				break;
+			}
+				
+			case expr_cmp_version:
+				cmp = compare_version(h_val, value);
+				break;
+
+			default:
+				break;
 		}
-		);
+		
+	} else if(value == NULL && h_val == NULL) {
+		cmp = 0;
+	} else if(value == NULL) {
+		cmp = 1;
+	} else {
+		cmp = -1;
+	}
 
-	if(empty) {
-		crm_err("Invalid Rule %s: rules must contain at least one expression", ID(rule));
+	switch(expr->op) {
+		case expr_op_defined:
+			if(h_val != NULL) { accept = TRUE; }
+			break;
+		case expr_op_not_defined:
+			if(h_val == NULL) { accept = TRUE; }
+			break;
+		case expr_op_eq:
+			if((h_val == value) || cmp == 0) {
+				accept = TRUE;
+			}
+			break;
+		case expr_op_ne:
+			if((h_val == NULL && value != NULL)
+			   || (h_val != NULL && value == NULL)
+			   || cmp != 0) {
+				accept = TRUE;
+			}
+			break;
+		default:
+			if(value == NULL || h_val == NULL) {
+				/* the comparision is meaningless from this point on */
+				accept = FALSE;
+				
+			} else if(expr->op == expr_op_lt) {
+				if(cmp < 0) { accept = TRUE; }
+				
+			} else if(expr->op == expr_op_lte) {
+				if(cmp <= 0) { accept = TRUE; }
+				
+			} else if(expr->op == expr_op_gt) {
+				if(cmp > 0) { accept = TRUE; }
+				
+			} else if(expr->op == expr_op_gte) {
+				if(cmp >= 0) { accept = TRUE; }		
+			}
+			break;
 	}
 	
-	crm_debug_2("Rule %s %s", ID(rule), passed?"passed":"failed");
+	return accept;
+}
+
+static gboolean
+eval_date_expression(compiled_expr_t *expr, ha_time_t *now)
+{
+	gboolean passed = FALSE;
+	ha_time_t *start = expr->start;
+	ha_time_t *end = expr->end;
+
+	crm_debug_2("Testing expression: %s", crm_str(expr->id));
+
+	switch(expr->date_op) {
+		case date_op_in_range:
+		case date_op_date_spec:
+			if(start != NULL && compare_date(start, now) > 0) {
+				passed = FALSE;
+			} else if(end != NULL && compare_date(end, now) < 0) {
+				passed = FALSE;
+			} else if(expr->date_op == date_op_in_range) {
+				passed = TRUE;
+			} else {
+				passed = cron_range_satisfied(now, expr->date_spec);
+			}
+			break;
+		case date_op_gt:
+			passed = (compare_date(start, now) < 0);
+			break;
+		case date_op_lt:
+			passed = (compare_date(end, now) > 0);
+			break;
+		case date_op_eq:
+			passed = (compare_date(start, now) == 0);
+			break;
+		case date_op_neq:
+			passed = (compare_date(start, now) != 0);
+			break;
+		default:
+			break;
+	}
 	return passed;
 }
 
-gboolean
-test_expression(xmlNode *expr, GHashTable *node_hash, enum rsc_role_e role,
-		ha_time_t *now)
+static gboolean
+eval_expression(compiled_expr_t *expr, GHashTable *node_hash,
+		enum rsc_role_e role, ha_time_t *now)
 {
 	gboolean accept = FALSE;
 	const char *uname = NULL;
 	
-	switch(find_expression_type(expr)) {
+	switch(expr->type) {
 		case nested_rule:
-			accept = test_rule(expr, node_hash, role, now);
+			accept = eval_rule(expr->rule, node_hash, role, now);
 			break;
 		case attr_expr:
 		case loc_expr:
@@ -110,16 +519,16 @@ test_expression(xmlNode *expr, GHashTable *node_hash, enum rsc_role_e role,
 			 * no node to compare with
 			 */
 			if(node_hash != NULL) {
-				accept = test_attr_expression(expr, node_hash, now);
+				accept = eval_attr_expression(expr, node_hash);
 			}
 			break;
 
 		case time_expr:
-			accept = test_date_expression(expr, now);
+			accept = eval_date_expression(expr, now);
 			break;
 
 		case role_expr:
-			accept = test_role_expression(expr, role, now);
+			accept = eval_role_expression(expr, role);
 			break;
 
 		default:
@@ -131,11 +540,95 @@ test_expression(xmlNode *expr, GHashTable *node_hash, enum rsc_role_e role,
 	}
 	
 	crm_debug_2("Expression %s %s on %s",
-		    ID(expr), accept?"passed":"failed",
+		    crm_str(expr->id), accept?"passed":"failed",
 		    uname?uname:"all ndoes");
 	return accept;
 }
 
+static gboolean
+eval_rule(compiled_rule_t *rule, GHashTable *node_hash, enum rsc_role_e role,
+	  ha_time_t *now) 
+{
+	gboolean test = TRUE;
+	gboolean passed = rule->do_and;
+
+	crm_debug_2("Testing rule %s", crm_str(rule->id));
+	slist_iter(
+		expr, compiled_expr_t, rule->exprs, lpc,
+		test = eval_expression(expr, node_hash, role, now);
+		
+		if(test && rule->do_and == FALSE) {
+			crm_debug_3("Expression %s/%s passed",
+				    crm_str(rule->id), crm_str(expr->id));
+			return TRUE;
+			
+		} else if(test == FALSE && rule->do_and) {
+			crm_debug_3("Expression %s/%s failed",
+				    crm_str(rule->id), crm_str(expr->id));
+			return FALSE;
+		}
+		);
+
+	if(rule->exprs == NULL) {
+		crm_err("Invalid Rule %s: rules must contain at least one expression",
+			crm_str(rule->id));
+	}
+	
+	crm_debug_2("Rule %s %s", crm_str(rule->id), passed?"passed":"failed");
+	return passed;
+}
+
+gboolean
+test_ruleset(xmlNode *ruleset, GHashTable *node_hash, ha_time_t *now) 
+{
+	gboolean ruleset_default = TRUE;
+	xml_child_iter_filter(
+		ruleset, rule, XML_TAG_RULE,
+
+		ruleset_default = FALSE;
+		if(test_rule(rule, node_hash, RSC_ROLE_UNKNOWN, now)) {
+			return TRUE;
+		}
+		);
+	
+	return ruleset_default;
+}
+
+gboolean
+test_rule(xmlNode *rule, GHashTable *node_hash, enum rsc_role_e role,
+	  ha_time_t *now) 
+{
+	gboolean passed = FALSE;
+	compiled_rule_t *compiled = NULL;
+
+	CRM_CHECK(rule != NULL, return FALSE);
+	if(rule_cache != NULL && rule->doc == rule_cache_doc) {
+		compiled = g_hash_table_lookup(rule_cache, rule);
+		if(compiled == NULL) {
+			compiled = compile_rule(rule);
+			g_hash_table_insert(rule_cache, rule, compiled);
+		}
+		return eval_rule(compiled, node_hash, role, now);
+	}
+
+	compiled = compile_rule(rule);
+	passed = eval_rule(compiled, node_hash, role, now);
+	free_compiled_rule(compiled);
+	return passed;
+}
+
+gboolean
+test_expression(xmlNode *expr, GHashTable *node_hash, enum rsc_role_e role,
+		ha_time_t *now)
+{
+	gboolean accept = FALSE;
+	compiled_expr_t *compiled = compile_expression(expr);
+
+	accept = eval_expression(compiled, node_hash, role, now);
+	free_compiled_expression(compiled);
+	return accept;
+}
+
 enum expression_type
 find_expression_type(xmlNode *expr) 
 {
@@ -163,156 +656,6 @@ find_expression_type(xmlNode *expr)
 	return attr_expr;
 }
 
-gboolean
-test_role_expression(
-	xmlNode *expr, enum rsc_role_e role, ha_time_t *now)
-{
-	gboolean accept = FALSE;
-	const char *op      = NULL;
-	const char *value   = NULL;
-
-	if(role == RSC_ROLE_UNKNOWN) {
-		return accept;
-	}
-	
-	value = crm_element_value(expr, XML_EXPR_ATTR_VALUE);
-	op    = crm_element_value(expr, XML_EXPR_ATTR_OPERATION);
-
-	if(safe_str_eq(op, "defined")) {
-		if(role > RSC_ROLE_STARTED) {
-			accept = TRUE;
-		}
-		
-	} else if(safe_str_eq(op, "not_defined")) {
-		if(role < RSC_ROLE_SLAVE && role > RSC_ROLE_UNKNOWN) {
-			accept = TRUE;
-		}
-		
-	} else if(safe_str_eq(op, "eq")) {
-		if(text2role(value) == role) {
-			accept = TRUE;
-		}
-		
-	} else if(safe_str_eq(op, "ne")) {
-		/* we will only test "ne" wtih master/slave roles style */
-		if(role < RSC_ROLE_SLAVE && role > RSC_ROLE_UNKNOWN) {
-			accept = FALSE;
-			
-		} else if(text2role(value) != role) {
-			accept = TRUE;
-		}
-	}	   
-	return accept;
-}
-
-gboolean
-test_attr_expression(xmlNode *expr, GHashTable *hash, ha_time_t *now)
-{
-	gboolean accept = FALSE;
-	int cmp = 0;
-	const char *h_val = NULL;
-
-	const char *op      = NULL;
-	const char *type    = NULL;
-	const char *attr    = NULL;
-	const char *value   = NULL;
-	
-	attr  = crm_element_value(expr, XML_EXPR_ATTR_ATTRIBUTE);
-	op    = crm_element_value(expr, XML_EXPR_ATTR_OPERATION);
-	value = crm_element_value(expr, XML_EXPR_ATTR_VALUE);
-	type  = crm_element_value(expr, XML_EXPR_ATTR_TYPE);
-	
-	if(attr == NULL || op == NULL) {
-		pe_err("Invlaid attribute or operation in expression"
-			" (\'%s\' \'%s\' \'%s\')",
-			crm_str(attr), crm_str(op), crm_str(value));
-		return FALSE;
-	}
-
-	if(hash != NULL) {
-		h_val = (const char*)g_hash_table_lookup(hash, attr);
-	}
-	
-	if(value != NULL && h_val != NULL) {
-		if(type == NULL) {		    
-		    if(safe_str_eq(op, "lt")
-		       || safe_str_eq(op, "lte")
-		       || safe_str_eq(op, "gt")
-		       || safe_str_eq(op, "gte")) {
-			type = "number";
-
-		    } else {
-			type = "string";
-		    }
-		    crm_debug_2("Defaulting to %s based comparison for '%s' op", type, op);
-		}
-	    
-		if(safe_str_eq(type, "string")) {
-			cmp = strcasecmp(h_val, value);
-			
-		} else if(safe_str_eq(type, "number")) {
-			int h_val_f = crm_parse_int(h_val, NULL);
-			int value_f = crm_parse_int(value, NULL);
-			
-			if(h_val_f < value_f) {
-				cmp = -1;
-			} else if(h_val_f > value_f)  {
-				cmp = 1;
-			} else {
-				cmp = 0;
-			}
-			
-		} else if(safe_str_eq(type, "version")) {
-			cmp = compare_version(h_val, value);
-			
-		}
-		
-	} else if(value == NULL && h_val == NULL) {
-		cmp = 0;
-	} else if(value == NULL) {
-		cmp = 1;
-	} else {
-		cmp = -1;
-	}
-	
-	if(safe_str_eq(op, "defined")) {
-		if(h_val != NULL) { accept = TRUE; }
-		
-	} else if(safe_str_eq(op, "not_defined")) {
-		if(h_val == NULL) { accept = TRUE; }
-		
-	} else if(safe_str_eq(op, "eq")) {
-		if((h_val == value) || cmp == 0) {
-			accept = TRUE;
-		}
-		
-	} else if(safe_str_eq(op, "ne")) {
-		if((h_val == NULL && value != NULL)
-		   || (h_val != NULL && value == NULL)
-		   || cmp != 0) {
-			accept = TRUE;
-		}
-		
-	} else if(value == NULL || h_val == NULL) {
-		/* the comparision is meaningless from this point on */
-		accept = FALSE;
-		
-	} else if(safe_str_eq(op, "lt")) {
-		if(cmp < 0) { accept = TRUE; }
-		
-	} else if(safe_str_eq(op, "lte")) {
-		if(cmp <= 0) { accept = TRUE; }
-		
-	} else if(safe_str_eq(op, "gt")) {
-		if(cmp > 0) { accept = TRUE; }
-		
-	} else if(safe_str_eq(op, "gte")) {
-		if(cmp >= 0) { accept = TRUE; }		
-	}
-	
-	return accept;
-}
-
 /* As per the nethack rules:
  *
  * moon period = 29.53058 days ~= 30, year = 365.2422 days
@@ -426,79 +769,6 @@ parse_xml_duration(ha_time_t *start, xmlNode *duration_spec)
 	return end;
 }
 
-	
-gboolean
-test_date_expression(xmlNode *time_expr, ha_time_t *now)
-{
-	ha_time_t *start = NULL;
-	ha_time_t *end = NULL;
-	const char *value = NULL;
-	char *value_copy = NULL;
-	char *value_copy_start = NULL;
-	const char *op = crm_element_value(time_expr, "operation");
-
-	xmlNode *duration_spec = NULL;
-	xmlNode *date_spec = NULL;
-
-	gboolean passed = FALSE;
-
-	crm_debug_2("Testing expression: %s", ID(time_expr));
-	
-	duration_spec = first_named_child(time_expr, "duration");
-	date_spec = first_named_child(time_expr, "date_spec");
-	
-	value = crm_element_value(time_expr, "start");
-	if(value != NULL) {
-		value_copy = crm_strdup(value);
-		value_copy_start = value_copy;
-		start = parse_date(&value_copy);
-		crm_free(value_copy_start);
-	}
-	value = crm_element_value(time_expr, "end");
-	if(value != NULL) {
-		value_copy = crm_strdup(value);
-		value_copy_start = value_copy;
-		end = parse_date(&value_copy);
-		crm_free(value_copy_start);
-	}
-
-	if(start != NULL && end == NULL && duration_spec != NULL) {
- 		end = parse_xml_duration(start, duration_spec);
-	}
-	if(op == NULL) {
-		op = "in_range";
-	}
-	
-	if(safe_str_eq(op, "date_spec") || safe_str_eq(op, "in_range")) {
-		if(start != NULL && compare_date(start, now) > 0) {
-			passed = FALSE;
-		} else if(end != NULL && compare_date(end, now) < 0) {
-			passed = FALSE;
-		} else if(safe_str_eq(op, "in_range")) {
-			passed = TRUE;
-		} else {
-			passed = cron_range_satisfied(now, date_spec);
-		}
-		
-	} else if(safe_str_eq(op, "gt") && compare_date(start, now) < 0) {
-		passed = TRUE;
-
-
-	} else if(safe_str_eq(op, "lt") && compare_date(end, now) > 0) {
-		passed = TRUE;
-
-	} else if(safe_str_eq(op, "eq") && compare_date(start, now) == 0) {
-		passed = TRUE;
-
-	} else if(safe_str_eq(op, "neq") && compare_date(start, now) != 0) {
-		passed = TRUE;
-	}
-
-	free_ha_date(start);
-	free_ha_date(end);
-	return passed;
-}
-
 
 typedef struct sorted_set_s 
 {
@@ -35,6 +35,8 @@
 extern xmlNode*get_object_root(
     const char *object_type, xmlNode *the_root);
 
+static void index_resources(pe_working_set_t *data_set);
+
 #define MEMCHECK_STAGE_0 0
 
 #define check_and_exit(stage) 	cleanup_calculations(data_set);		\
@@ -79,6 +81,8 @@ cluster_status(pe_working_set_t *data_set)
 	if(data_set->now == NULL) {
 	    data_set->now = new_ha_date(TRUE);
 	}
+
+	pe_enable_rule_cache(data_set->input);
 	
 	if(data_set->input != NULL
 	   && crm_element_value(data_set->input, XML_ATTR_DC_UUID) != NULL) {
@@ -103,8 +107,15 @@ cluster_status(pe_working_set_t *data_set)
 			 " - fencing and resource management disabled");
 	}
 	
+	data_set->node_uname_index = g_hash_table_new(
+		crm_strcase_hash, crm_strcase_equal);
+	data_set->node_id_index = g_hash_table_new(
+		crm_strcase_hash, crm_strcase_equal);
  	unpack_nodes(cib_nodes, data_set);
+
  	unpack_resources(cib_resources, data_set);
+	index_resources(data_set);
+
  	unpack_status(cib_status, data_set);
 	
 	return TRUE;
@@ -156,6 +167,9 @@ pe_free_nodes(GListPtr nodes)
 			if(details->attrs != NULL) {
 				g_hash_table_destroy(details->attrs);
 			}
+			if(details->failcounts != NULL) {
+				g_hash_table_destroy(details->failcounts);
+			}
 			pe_free_shallow_adv(details->running_rsc, FALSE);
 			pe_free_shallow_adv(details->allocated_rsc, FALSE);
 			crm_free(details);
@@ -181,15 +195,40 @@ cleanup_calculations(pe_working_set_t *data_set)
 	
 	crm_free(data_set->dc_uuid);
 	
+	if(data_set->resource_index != NULL) {
+		g_hash_table_destroy(data_set->resource_index);
+		data_set->resource_index = NULL;
+	}
+	if(data_set->node_uname_index != NULL) {
+		g_hash_table_destroy(data_set->node_uname_index);
+		data_set->node_uname_index = NULL;
+	}
+	if(data_set->node_id_index != NULL) {
+		g_hash_table_destroy(data_set->node_id_index);
+		data_set->node_id_index = NULL;
+	}
+	
 	crm_debug_3("deleting resources");
 	pe_free_resources(data_set->resources); 
 	
 	crm_debug_3("deleting actions");
+	pe_free_action_index(data_set->action_index);
+	data_set->action_index = NULL;
+	if(data_set->action_edges != NULL) {
+		g_hash_table_destroy(data_set->action_edges);
+		data_set->action_edges = NULL;
+	}
 	pe_free_actions(data_set->actions);
 
 	crm_debug_3("deleting nodes");
 	pe_free_nodes(data_set->nodes);
 	
+	pe_free_arena(data_set->arena);
+	data_set->arena = NULL;
+
+	/* compiled rules point into data_set->input */
+	pe_flush_rule_cache();
+	
 	free_xml(data_set->graph);
 	free_ha_date(data_set->now);
 	free_xml(data_set->input);
@@ -216,12 +255,21 @@ set_working_set_defaults(pe_working_set_t *data_set)
 
 	data_set->nodes			  = NULL;
 	data_set->actions		  = NULL;	
+	data_set->action_index		  = NULL;
+	data_set->action_edges		  = NULL;
 	data_set->resources		  = NULL;
+	data_set->resource_index	  = NULL;
+	data_set->node_id_index		  = NULL;
+	data_set->node_uname_index	  = NULL;
 	data_set->config_hash		  = NULL;
 	data_set->stonith_action	  = NULL;
+	data_set->arena			  = NULL;
 	data_set->ordering_constraints    = NULL;
 	data_set->placement_constraints   = NULL;
 	data_set->colocation_constraints  = NULL;
+	data_set->placement_tail          = NULL;
+	data_set->ordering_tail           = NULL;
+	data_set->colocation_tail         = NULL;
 
 	data_set->order_id		  = 1;
 	data_set->action_id		  = 1;
@@ -285,3 +333,267 @@ pe_find_node(GListPtr nodes, const char *uname)
     /* error */
     return NULL;
 }
+
+node_t *
+pe_lookup_node_id(pe_working_set_t *data_set, const char *id)
+{
+    if(data_set->node_id_index == NULL || id == NULL) {
+	return pe_find_node_id(data_set->nodes, id);
+    }
+    return g_hash_table_lookup(data_set->node_id_index, id);
+}
+
+node_t *
+pe_lookup_node(pe_working_set_t *data_set, const char *uname)
+{
+    if(data_set->node_uname_index == NULL || uname == NULL) {
+	return pe_find_node(data_set->nodes, uname);
+    }
+    return g_hash_table_lookup(data_set->node_uname_index, uname);
+}
+
+void
+pe_index_node(node_t *node, pe_working_set_t *data_set)
+{
+    /* The first entry wins, just like it would for a list scan */
+    const char *id = node->details->id;
+    const char *uname = node->details->uname;
+
+    if(data_set->node_id_index != NULL && id != NULL
+       && g_hash_table_lookup(data_set->node_id_index, id) == NULL) {
+	g_hash_table_insert(data_set->node_id_index, (gpointer)id, node);
+    }
+    if(data_set->node_uname_index != NULL && uname != NULL
+       && g_hash_table_lookup(data_set->node_uname_index, uname) == NULL) {
+	g_hash_table_insert(data_set->node_uname_index, (gpointer)uname, node);
+    }
+}
+
+static void
+free_rsc_bucket(gpointer data)
+{
+    g_list_free((GListPtr)data);
+}
+
+static void
+index_resource_name(GHashTable *index, const char *name, resource_t *rsc)
+{
+    GListPtr bucket = NULL;
+
+    if(name == NULL) {
+	return;
+    }
+
+    bucket = g_hash_table_lookup(index, name);
+    if(bucket == NULL) {
+	g_hash_table_insert(index, crm_strdup(name), g_list_append(NULL, rsc));
+
+    } else if(g_list_find(bucket, rsc) == NULL) {
+	/* non-empty, so the head (and therefor the hash value) is unchanged */
+	bucket = g_list_append(bucket, rsc);
+    }
+}
+
+static void
+unindex_resource_name(GHashTable *index, const char *name, resource_t *rsc)
+{
+    gpointer bucket = NULL;
+    gpointer orig_key = NULL;
+
+    if(name == NULL
+       || g_hash_table_lookup_extended(index, name, &orig_key, &bucket) == FALSE) {
+	return;
+    }
+
+    g_hash_table_steal(index, name);
+    bucket = g_list_remove(bucket, rsc);
+    if(bucket == NULL) {
+	crm_free(orig_key);
+
+    } else {
+	g_hash_table_insert(index, orig_key, bucket);
+    }
+}
+
+void
+pe_index_resource(resource_t *rsc, pe_working_set_t *data_set)
+{
+    GHashTable *index = data_set->resource_index;
+    if(index == NULL) {
+	/* Not built yet, index_resources() will pick it up */
+	return;
+    }
+    
+    index_resource_name(index, rsc->id, rsc);
+    index_resource_name(index, rsc->long_name, rsc);
+    index_resource_name(index, rsc->clone_name, rsc);
+
+    slist_iter(
+	child, resource_t, rsc->children, lpc,
+	pe_index_resource(child, data_set);
+	);
+}
+
+static void
+index_resources(pe_working_set_t *data_set)
+{
+    data_set->resource_index = g_hash_table_new_full(
+	g_str_hash, g_str_equal, g_hash_destroy_str, free_rsc_bucket);
+
+    slist_iter(
+	rsc, resource_t, data_set->resources, lpc,
+	pe_index_resource(rsc, data_set);
+	);
+}
+
+void
+pe_set_clone_name(resource_t *rsc, const char *name, pe_working_set_t *data_set)
+{
+    if(rsc->clone_name != NULL && data_set->resource_index != NULL) {
+	/* Only drop it if no other field still maps rsc to this name */
+	if(safe_str_neq(rsc->clone_name, rsc->id)
+	   && safe_str_neq(rsc->clone_name, rsc->long_name)) {
+	    unindex_resource_name(data_set->resource_index, rsc->clone_name, rsc);
+	}
+    }
+    
+    crm_free(rsc->clone_name);
+    if(name != NULL) {
+	rsc->clone_name = crm_strdup(name);
+	if(data_set->resource_index != NULL) {
+	    index_resource_name(data_set->resource_index, rsc->clone_name, rsc);
+	}
+    }
+}
+
+static gboolean
+rsc_has_name(resource_t *rsc, const char *id, gboolean renamed)
+{
+    if(strcmp(rsc->id, id) == 0) {
+	return TRUE;
+
+    } else if(rsc->long_name && strcmp(rsc->long_name, id) == 0) {
+	return TRUE;
+
+    } else if(renamed && rsc->clone_name && strcmp(rsc->clone_name, id) == 0) {
+	return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean
+rsc_is_within(resource_t *rsc, resource_t *ancestor)
+{
+    for(; rsc != NULL; rsc = rsc->parent) {
+	if(rsc == ancestor) {
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+/* Would a depth-first search of data_set->resources reach 'a' before 'b'?
+ *
+ * Only called when more than one resource answers to the same name,
+ * so we calculate it on demand rather than keeping sequence numbers
+ * in sync with every re-ordering of rsc->children
+ */
+static gboolean
+rsc_searched_first(resource_t *a, resource_t *b, pe_working_set_t *data_set)
+{
+    gboolean result = FALSE;
+    GListPtr path_a = NULL;
+    GListPtr path_b = NULL;
+    GListPtr iter_a = NULL;
+    GListPtr iter_b = NULL;
+    GListPtr siblings = data_set->resources;
+    resource_t *parent = NULL;
+
+    for(parent = a; parent != NULL; parent = parent->parent) {
+	path_a = g_list_prepend(path_a, parent);
+    }
+    for(parent = b; parent != NULL; parent = parent->parent) {
+	path_b = g_list_prepend(path_b, parent);
+    }
+
+    iter_a = path_a;
+    iter_b = path_b;
+    while(iter_a != NULL && iter_b != NULL && iter_a->data == iter_b->data) {
+	siblings = ((resource_t*)iter_a->data)->children;
+	iter_a = iter_a->next;
+	iter_b = iter_b->next;
+    }
+
+    if(iter_a == NULL) {
+	/* 'a' is 'b' or one of its parents, parents are checked first */
+	result = TRUE;
+	
+    } else if(iter_b == NULL) {
+	result = FALSE;
+	
+    } else {
+	result = g_list_index(siblings, iter_a->data) < g_list_index(siblings, iter_b->data);
+    }
+    
+    g_list_free(path_a);
+    g_list_free(path_b);
+    return result;
+}
+
+/* Equivalent to calling find_rsc(pe_find_current) on 'within' (or on
+ * each of data_set->resources when NULL) but without the search
+ */
+resource_t *
+pe_find_indexed_resource(
+    pe_working_set_t *data_set, const char *id, resource_t *within, gboolean renamed)
+{
+    resource_t *match = NULL;
+    GListPtr bucket = NULL;
+
+    if(id == NULL) {
+	return NULL;
+	
+    } else if(data_set->resource_index == NULL) {
+	int flags = pe_find_current;
+	if(renamed) {
+	    flags |= pe_find_renamed;
+	}
+	if(within != NULL) {
+	    return within->fns->find_rsc(within, id, NULL, flags);
+	}
+	slist_iter(
+	    rsc, resource_t, data_set->resources, lpc,
+	    match = rsc->fns->find_rsc(rsc, id, NULL, flags);
+	    if(match != NULL) {
+		return match;
+	    }
+	    );
+	return NULL;
+    }
+
+    bucket = g_hash_table_lookup(data_set->resource_index, id);
+    slist_iter(
+	rsc, resource_t, bucket, lpc,
+	if(rsc_has_name(rsc, id, renamed) == FALSE) {
+	    continue;
+
+	} else if(within != NULL && rsc_is_within(rsc, within) == FALSE) {
+	    continue;
+
+	} else if(match == NULL || rsc_searched_first(rsc, match, data_set)) {
+	    match = rsc;
+	}
+	);
+    
+    return match;
+}
+
+resource_t *
+pe_lookup_resource(pe_working_set_t *data_set, const char *id)
+{
+    resource_t *match = pe_find_indexed_resource(data_set, id, NULL, TRUE);
+    if(match == NULL) {
+	crm_debug_2("No match for %s", crm_str(id));
+    }
+    return match;
+}
@@ -171,6 +171,10 @@ unpack_config(xmlNode *config, pe_working_set_t *data_set)
 	crm_debug_2("Start failures are %s",
 		    is_set(data_set->flags, pe_flag_start_failure_fatal)?"always fatal":"handled by failcount");
 
+	set_config_flag(data_set, "compact-transition-graph", pe_flag_compact_graph);
+	crm_debug_2("Synapse inputs are %s",
+		    is_set(data_set->flags, pe_flag_compact_graph)?"referred to by id":"copied");
+
 	node_score_red    = char2score(pe_pref(data_set->config_hash, "node-health-red"));
 	node_score_green  = char2score(pe_pref(data_set->config_hash, "node-health-green"));
 	node_score_yellow = char2score(pe_pref(data_set->config_hash, "node-health-yellow"));
@@ -187,9 +191,11 @@ gboolean
 unpack_nodes(xmlNode * xml_nodes, pe_working_set_t *data_set)
 {
 	node_t *new_node   = NULL;
+	node_t *same_id    = NULL;
 	const char *id     = NULL;
 	const char *uname  = NULL;
 	const char *type   = NULL;
+	int node_index     = 0;
 	gboolean unseen_are_unclean = TRUE;
 	const char *blind_faith = pe_pref(
 		data_set->config_hash, "startup-fencing");
@@ -217,7 +223,7 @@ unpack_nodes(xmlNode * xml_nodes, pe_working_set_t *data_set)
 			crm_config_err("Must specify type tag in <node>");
 			continue;
 		}
-		if(pe_find_node(data_set->nodes, uname) != NULL) {
+		if(pe_lookup_node(data_set, uname) != NULL) {
 		    crm_config_warn("Detected multiple node entries with uname=%s"
 				    " - this is rarely intended", uname);
 		}
@@ -240,6 +246,16 @@ unpack_nodes(xmlNode * xml_nodes, pe_working_set_t *data_set)
 		crm_debug_3("Creaing node for entry %s/%s", uname, id);
 		new_node->details->id		= id;
 		new_node->details->uname	= uname;
+
+		/* The node_list_* functions treat entries with the same id
+		 * as the same node, so they must share a slot
+		 */
+		same_id = pe_lookup_node_id(data_set, id);
+		if(same_id != NULL) {
+			new_node->details->index = same_id->details->index;
+		} else {
+			new_node->details->index = node_index++;
+		}
 		new_node->details->type		= node_ping;
 		new_node->details->online	= FALSE;
 		new_node->details->shutdown	= FALSE;
@@ -273,6 +289,7 @@ unpack_nodes(xmlNode * xml_nodes, pe_working_set_t *data_set)
 
 		add_node_attrs(xml_obj, new_node, FALSE, data_set);
 		data_set->nodes = g_list_append(data_set->nodes, new_node);    
+		pe_index_node(new_node, data_set);
 		crm_debug_3("Done with node %s",
 			    crm_element_value(xml_obj, XML_ATTR_UNAME));
 		);
@@ -344,7 +361,7 @@ unpack_status(xmlNode * status, pe_working_set_t *data_set)
 		lrm_rsc = find_xml_node(lrm_rsc, XML_LRM_TAG_RESOURCES, FALSE);
 
 		crm_debug_3("Processing node %s", uname);
-		this_node = pe_find_node_id(data_set->nodes, id);
+		this_node = pe_lookup_node_id(data_set, id);
 
 		if(uname == NULL) {
 			/* error */
@@ -388,7 +405,7 @@ unpack_status(xmlNode * status, pe_working_set_t *data_set)
 		status, node_state, XML_CIB_TAG_STATE,
 
 		id = crm_element_value(node_state, XML_ATTR_ID);
-		this_node = pe_find_node_id(data_set->nodes, id);
+		this_node = pe_lookup_node_id(data_set, id);
 		
 		if(this_node == NULL) {
 			crm_info("Node %s is unknown", id);
@@ -416,7 +433,7 @@ unpack_status(xmlNode * status, pe_working_set_t *data_set)
 		}
 
 		id = crm_element_value(node_state, XML_ATTR_ID);
-		this_node = pe_find_node_id(data_set->nodes, id);
+		this_node = pe_lookup_node_id(data_set, id);
 		
 		if(this_node == NULL || this_node->details->online) {
 			continue;
@@ -837,6 +854,7 @@ create_fake_resource(const char *rsc_id, xmlNode *rsc_entry, pe_working_set_t *d
 	set_bit(rsc->flags, pe_rsc_orphan);
 	
 	data_set->resources = g_list_append(data_set->resources, rsc);
+	pe_index_resource(rsc, data_set);
 	return rsc;
 }
 
@@ -864,7 +882,7 @@ static resource_t *find_clone(pe_working_set_t *data_set, node_t *node, resource
     
     if(is_set(parent->flags, pe_rsc_unique)) {
 	crm_debug_3("Looking for %s", rsc_id);
-	rsc = parent->fns->find_rsc(parent, rsc_id, NULL, pe_find_current);
+	rsc = pe_find_indexed_resource(data_set, rsc_id, parent, FALSE);
 
     } else {
 	crm_debug_3("Looking for %s on %s", base, node->details->uname);
@@ -909,14 +927,14 @@ static resource_t *find_clone(pe_working_set_t *data_set, node_t *node, resource
 	    }	    
 	}
 	
-        if(parent->fns->find_rsc(parent, rsc_id, NULL, pe_find_current)) {
+        if(pe_find_indexed_resource(data_set, rsc_id, parent, FALSE)) {
             alt_rsc_id = crm_strdup(rsc_id);
         } else {
             alt_rsc_id = clone_zero(rsc_id);
         }
 
 	while(rsc == NULL) {
-	    rsc = parent->fns->find_rsc(parent, alt_rsc_id, NULL, pe_find_current);
+	    rsc = pe_find_indexed_resource(data_set, alt_rsc_id, parent, FALSE);
 	    if(rsc == NULL) {
 		crm_debug_3("Unknown resource: %s", alt_rsc_id);
 		break;
@@ -942,12 +960,12 @@ static resource_t *find_clone(pe_working_set_t *data_set, node_t *node, resource
 	CRM_ASSERT(rsc != NULL);
     }
 
-    crm_free(rsc->clone_name); rsc->clone_name = NULL;
+    pe_set_clone_name(rsc, NULL, data_set);
     if(safe_str_neq(rsc_id, rsc->id)) {
 	crm_info("Internally renamed %s on %s to %s%s",
 		 rsc_id, node->details->uname, rsc->id,
 		 is_set(rsc->flags, pe_rsc_orphan)?" (ORPHAN)":"");
-	rsc->clone_name = crm_strdup(rsc_id);
+	pe_set_clone_name(rsc, rsc_id, data_set);
     }
     
     crm_free(alt_rsc_id);
@@ -965,12 +983,12 @@ unpack_find_resource(
 	
 	crm_debug_2("looking for %s", rsc_id);
 		
-	rsc = pe_find_resource(data_set->resources, alt_rsc_id);
+	rsc = pe_lookup_resource(data_set, alt_rsc_id);
 	/* no match */
 	if(rsc == NULL) {
 	    /* Even when clone-max=0, we still create a single :0 orphan to match against */
 	    char *tmp = clone_zero(alt_rsc_id);
-	    resource_t *clone0 = pe_find_resource(data_set->resources, tmp);
+	    resource_t *clone0 = pe_lookup_resource(data_set, tmp);
 	    clone_parent = uber_parent(clone0);
 	    crm_free(tmp);
 	    
@@ -1022,7 +1040,7 @@ process_rsc_state(resource_t *rsc, node_t *node,
 	    
 	    on_fail = action_fail_recover;
 	    
-	    from = pe_find_node_id(data_set->nodes, uuid);
+	    from = pe_lookup_node_id(data_set, uuid);
 	    if(from != NULL) {
 		process_rsc_state(rsc, from, on_fail, NULL, data_set);
 	    } else {
@@ -1114,12 +1132,11 @@ process_rsc_state(resource_t *rsc, node_t *node,
 	} else if(rsc->clone_name) {
 		crm_debug_2("Resetting clone_name %s for %s (stopped)",
 			    rsc->clone_name, rsc->id);
-		crm_free(rsc->clone_name);
-		rsc->clone_name = NULL;
+		pe_set_clone_name(rsc, NULL, data_set);
 
 	} else {
 		char *key = stop_key(rsc);
-		GListPtr possible_matches = find_actions(rsc->actions, key, node);
+		GListPtr possible_matches = find_actions(rsc->action_index, key, node);
 		slist_iter(stop, action_t, possible_matches, lpc,
 			   stop->optional = TRUE;
 			);
@@ -1777,6 +1794,8 @@ add_node_attrs(xmlNode *xml_obj, node_t *node, gboolean overwrite, pe_working_se
 		data_set->input, xml_obj, XML_TAG_ATTR_SETS, NULL,
 		node->details->attrs, NULL, overwrite, data_set->now);
 
+	node->details->attrs_version++;
+	index_failcounts(node);
 	return TRUE;
 }
 
@@ -1851,7 +1870,7 @@ GListPtr find_operations(
 	    continue;
 	}
 
-	this_node = pe_find_node(data_set->nodes, uname);
+	this_node = pe_lookup_node(data_set, uname);
 	CRM_CHECK(this_node != NULL, continue);
 	
 	determine_online_status(node_state, this_node, data_set);
@@ -34,6 +34,9 @@ gboolean ghash_free_str_str(gpointer key, gpointer value, gpointer user_data);
 void unpack_operation(
 	action_t *action, xmlNode *xml_obj, pe_working_set_t* data_set);
 static xmlNode *find_rsc_op_entry_helper(resource_t * rsc, const char *key, gboolean include_disabled);
+static void index_action(
+	pe_action_index_t **index, action_t *action, gboolean by_task);
+static GListPtr lookup_bucket(GHashTable *table, const char *key);
 
 void
 pe_free_shallow(GListPtr alist)
@@ -68,6 +71,82 @@ pe_free_shallow_adv(GListPtr alist, gboolean with_data)
 }
 
 
+/* A region allocator for objects that live as long as the working set
+ *
+ * Each pengine run creates tens of thousands of actions, wrappers and
+ * constraints.  Carving them out of large blocks keeps them from
+ * fragmenting the heap and lets cleanup_calculations() release them
+ * with a handful of free() calls.  Memory is returned zeroed.
+ */
+#define PE_ARENA_BLOCK_SIZE	(64 * 1024)
+#define PE_ARENA_ALIGN(size)	(((size) + 2*sizeof(void*) - 1) & ~(2*sizeof(void*) - 1))
+
+struct pe_arena_s 
+{
+	struct pe_arena_s *next;
+	size_t size;
+	size_t used;
+};
+
+void *
+pe_arena_alloc(pe_working_set_t *data_set, size_t size)
+{
+	void *mem = NULL;
+	pe_arena_t *block = NULL;
+	size_t header = PE_ARENA_ALIGN(sizeof(pe_arena_t));
+
+	CRM_ASSERT(data_set != NULL);
+	size = PE_ARENA_ALIGN(size);
+
+	block = data_set->arena;
+	if(block == NULL || block->used + size > block->size) {
+		size_t block_size = PE_ARENA_BLOCK_SIZE;
+		if(size > block_size - header) {
+			block_size = header + size;
+		}
+		
+		crm_malloc0(block, block_size);
+		block->size = block_size;
+		block->used = header;
+
+		if(data_set->arena != NULL && block_size > PE_ARENA_BLOCK_SIZE) {
+			/* Keep filling the current block with small objects */
+			block->next = data_set->arena->next;
+			data_set->arena->next = block;
+			
+		} else {
+			block->next = data_set->arena;
+			data_set->arena = block;
+		}
+	}
+
+	mem = ((char*)block) + block->used;
+	block->used += size;
+	return mem;
+}
+
+void
+pe_free_arena(pe_arena_t *arena) 
+{
+	while(arena != NULL) {
+		pe_arena_t *next = arena->next;
+		crm_free(arena);
+		arena = next;
+	}
+}
+
+/* Copy of a node whose lifetime is that of the working set */
+static node_t *
+node_copy_for(node_t *this_node, pe_working_set_t *data_set) 
+{
+	node_t *new_node = pe_arena_alloc(data_set, sizeof(node_t));
+
+	new_node->weight  = this_node->weight; 
+	new_node->fixed   = this_node->fixed;
+	new_node->details = this_node->details;	
+	return new_node;
+}
+
 node_t *
 node_copy(node_t *this_node) 
 {
@@ -88,54 +167,108 @@ node_copy(node_t *this_node)
 	return new_node;
 }
 
+/* Size of a vector able to hold every node in list1 and list2 */
+static int
+node_vector_size(GListPtr list1, GListPtr list2)
+{
+	int size = 0;
+	slist_iter(
+		node, node_t, list1, lpc,
+		if(node != NULL && node->details->index >= size) {
+			size = node->details->index + 1;
+		}
+		);
+	slist_iter(
+		node, node_t, list2, lpc,
+		if(node != NULL && node->details->index >= size) {
+			size = node->details->index + 1;
+		}
+		);
+	return size;
+}
+
+/* A dense array addressed by node->details->index
+ *
+ * Replaces pe_find_node_id(list, node->details->id) with a single
+ * array access so that the functions below are linear rather than
+ * O(n*m).  As with pe_find_node_id(), the first entry for a node wins.
+ */
+static node_t **
+node_vector(GListPtr list, int size)
+{
+	node_t **vector = NULL;
+
+	crm_malloc0(vector, (size + 1) * sizeof(node_t*));
+	slist_iter(
+		node, node_t, list, lpc,
+		if(node != NULL && vector[node->details->index] == NULL) {
+			vector[node->details->index] = node;
+		}
+		);
+	return vector;
+}
+
+/* For callers that look up many nodes in the same list */
+node_t **
+node_list_vector(GListPtr list, int *size)
+{
+	*size = node_vector_size(list, NULL);
+	return node_vector(list, *size);
+}
+
+node_t *
+node_vector_find(node_t **vector, int size, const node_t *node)
+{
+	if(node == NULL || node->details->index >= size) {
+		return NULL;
+	}
+	return vector[node->details->index];
+}
+
 /* are the contents of list1 and list2 equal 
  * nodes with weight < 0 are ignored if filter == TRUE
- *
- * slow but linear
- *
  */
 gboolean
 node_list_eq(GListPtr list1, GListPtr list2, gboolean filter)
 {
-	node_t *other_node;
+	gboolean result = TRUE;
+	node_t *other_node = NULL;
+	int size = node_vector_size(list1, list2);
+	node_t **in_list1 = node_vector(list1, size);
+	node_t **in_list2 = node_vector(list2, size);
 
-	GListPtr lhs = list1;
-	GListPtr rhs = list2;
-	
 	slist_iter(
-		node, node_t, lhs, lpc,
+		node, node_t, list1, lpc,
 
 		if(node == NULL || (filter && node->weight < 0)) {
 			continue;
 		}
 
-		other_node = (node_t*)
-			pe_find_node_id(rhs, node->details->id);
-
+		other_node = in_list2[node->details->index];
 		if(other_node == NULL || other_node->weight < 0) {
-			return FALSE;
+			result = FALSE;
+			goto done;
 		}
 		);
 	
-	lhs = list2;
-	rhs = list1;
-
 	slist_iter(
-		node, node_t, lhs, lpc,
+		node, node_t, list2, lpc,
 
 		if(node == NULL || (filter && node->weight < 0)) {
 			continue;
 		}
 
-		other_node = (node_t*)
-			pe_find_node_id(rhs, node->details->id);
-
+		other_node = in_list1[node->details->index];
 		if(other_node == NULL || other_node->weight < 0) {
-			return FALSE;
+			result = FALSE;
+			goto done;
 		}
 		);
-  
-	return TRUE;
+
+  done:
+	crm_free(in_list1);
+	crm_free(in_list2);
+	return result;
 }
 
 /* any node in list1 or list2 and not in the other gets a score of -INFINITY */
@@ -144,11 +277,14 @@ node_list_exclude(GListPtr list1, GListPtr list2, gboolean merge_scores)
 {
     node_t *other_node = NULL;
     GListPtr result = list1;
+    int size = node_vector_size(list1, list2);
+    node_t **in_result = node_vector(result, size);
+    node_t **in_list2 = node_vector(list2, size);
     
     slist_iter(
 	node, node_t, result, lpc,
 	
-	other_node = pe_find_node_id(list2, node->details->id);
+	other_node = in_list2[node->details->index];
 	
 	if(other_node == NULL) {
 	    node->weight = -INFINITY;
@@ -160,15 +296,18 @@ node_list_exclude(GListPtr list1, GListPtr list2, gboolean merge_scores)
     slist_iter(
 	node, node_t, list2, lpc,
 	
-	other_node = pe_find_node_id(result, node->details->id);
+	other_node = in_result[node->details->index];
 	
 	if(other_node == NULL) {
 	    node_t *new_node = node_copy(node);
 	    new_node->weight = -INFINITY;
 	    result = g_list_append(result, new_node);
+	    in_result[node->details->index] = new_node;
 	}
 	);
 
+    crm_free(in_result);
+    crm_free(in_list2);
     return result;
 }
 
@@ -177,11 +316,11 @@ GListPtr
 node_list_and(GListPtr list1, GListPtr list2, gboolean filter)
 {
 	GListPtr result = NULL;
-	unsigned lpc = 0;
+	node_t **in_list2 = node_vector(list2, node_vector_size(list1, list2));
 
-	for(lpc = 0; lpc < g_list_length(list1); lpc++) {
-		node_t *node = (node_t*)g_list_nth_data(list1, lpc);
-		node_t *other_node = pe_find_node_id(list2, node->details->id);
+	slist_iter(
+		node, node_t, list1, lpc,
+		node_t *other_node = in_list2[node->details->index];
 		node_t *new_node = NULL;
 
 		if(other_node != NULL) {
@@ -206,8 +345,9 @@ node_list_and(GListPtr list1, GListPtr list2, gboolean filter)
 		if(new_node != NULL) {
 			result = g_list_append(result, new_node);
 		}
-	}
+		);
 
+	crm_free(in_list2);
 	return result;
 }
 
@@ -217,13 +357,13 @@ GListPtr
 node_list_minus(GListPtr list1, GListPtr list2, gboolean filter)
 {
 	GListPtr result = NULL;
+	node_t **in_list2 = node_vector(list2, node_vector_size(list1, list2));
 
 	slist_iter(
 		node, node_t, list1, lpc,
-		node_t *other_node = pe_find_node_id(list2, node->details->id);
 		node_t *new_node = NULL;
 		
-		if(node == NULL || other_node != NULL
+		if(node == NULL || in_list2[node->details->index] != NULL
 		   || (filter && node->weight < 0)) {
 			continue;
 			
@@ -234,6 +374,7 @@ node_list_minus(GListPtr list1, GListPtr list2, gboolean filter)
   
 	crm_debug_3("Minus result len: %d", g_list_length(result));
 
+	crm_free(in_list2);
 	return result;
 }
 
@@ -242,14 +383,15 @@ GListPtr
 node_list_xor(GListPtr list1, GListPtr list2, gboolean filter)
 {
 	GListPtr result = NULL;
+	int size = node_vector_size(list1, list2);
+	node_t **in_list1 = node_vector(list1, size);
+	node_t **in_list2 = node_vector(list2, size);
 	
 	slist_iter(
 		node, node_t, list1, lpc,
 		node_t *new_node = NULL;
-		node_t *other_node = (node_t*)
-			pe_find_node_id(list2, node->details->id);
 
-		if(node == NULL || other_node != NULL
+		if(node == NULL || in_list2[node->details->index] != NULL
 		   || (filter && node->weight < 0)) {
 			continue;
 		}
@@ -261,10 +403,8 @@ node_list_xor(GListPtr list1, GListPtr list2, gboolean filter)
 	slist_iter(
 		node, node_t, list2, lpc,
 		node_t *new_node = NULL;
-		node_t *other_node = (node_t*)
-			pe_find_node_id(list1, node->details->id);
 
-		if(node == NULL || other_node != NULL
+		if(node == NULL || in_list1[node->details->index] != NULL
 		   || (filter && node->weight < 0)) {
 			continue;
 		}
@@ -273,6 +413,9 @@ node_list_xor(GListPtr list1, GListPtr list2, gboolean filter)
 		);
   
 	crm_debug_3("Xor result len: %d", g_list_length(result));
+
+	crm_free(in_list1);
+	crm_free(in_list2);
 	return result;
 }
 
@@ -280,10 +423,12 @@ GListPtr
 node_list_or(GListPtr list1, GListPtr list2, gboolean filter)
 {
 	node_t *other_node = NULL;
+	node_t **in_result = NULL;
 	GListPtr result = NULL;
 	gboolean needs_filter = FALSE;
 
 	result = node_list_dup(list1, FALSE, filter);
+	in_result = node_vector(result, node_vector_size(result, list2));
 
 	slist_iter(
 		node, node_t, list2, lpc,
@@ -292,8 +437,7 @@ node_list_or(GListPtr list1, GListPtr list2, gboolean filter)
 			continue;
 		}
 
-		other_node = (node_t*)pe_find_node_id(
-			result, node->details->id);
+		other_node = in_result[node->details->index];
 
 		if(other_node != NULL) {
 			crm_debug_4("%s + %s: %d + %d",
@@ -310,8 +454,10 @@ node_list_or(GListPtr list1, GListPtr list2, gboolean filter)
 		} else if(filter == FALSE || node->weight >= 0) {
 			node_t *new_node = node_copy(node);
 			result = g_list_append(result, new_node);
+			in_result[node->details->index] = new_node;
 		}
 		);
+	crm_free(in_result);
 
 	/* not the neatest way, but the most expedient for now */
 	if(filter && needs_filter) {
@@ -442,7 +588,7 @@ custom_action(resource_t *rsc, char *key, const char *task,
 	CRM_CHECK(task != NULL, return NULL);
 
 	if(save_action && rsc != NULL) {
-		possible_matches = find_actions(rsc->actions, key, on_node);
+		possible_matches = find_actions(rsc->action_index, key, on_node);
 	}
 	
 	if(possible_matches != NULL) {
@@ -467,16 +613,22 @@ custom_action(resource_t *rsc, char *key, const char *task,
 				    on_node?on_node->details->uname:"<NULL>");
 		}
 		
-		crm_malloc0(action, sizeof(action_t));
+		/* Unsaved actions are freed by the caller long before
+		 * cleanup_calculations(), so keep them off the arena
+		 */
 		if(save_action) {
+			action = pe_arena_alloc(data_set, sizeof(action_t));
 			action->id   = data_set->action_id++;
 		} else {
+			crm_malloc0(action, sizeof(action_t));
 			action->id = 0;
 		}
 		action->rsc  = rsc;
 		CRM_ASSERT(task != NULL);
 		action->task = crm_strdup(task);
-		if(on_node) {
+		if(on_node && save_action) {
+		    action->node = node_copy_for(on_node, data_set);
+		} else if(on_node) {
 		    action->node = node_copy(on_node);
 		}
 		action->uuid = crm_strdup(key);
@@ -501,6 +653,7 @@ custom_action(resource_t *rsc, char *key, const char *task,
 		if(save_action) {
 			data_set->actions = g_list_append(
 				data_set->actions, action);
+			index_action(&(data_set->action_index), action, FALSE);
 		}		
 		
 		if(rsc != NULL) {
@@ -512,6 +665,7 @@ custom_action(resource_t *rsc, char *key, const char *task,
 			if(save_action) {
 				rsc->actions = g_list_append(
 					rsc->actions, action);
+				index_action(&(rsc->action_index), action, TRUE);
 			}
 		}
 		
@@ -1008,18 +1162,73 @@ pe_free_action(action_t *action)
 	if(action == NULL) {
 		return;
 	}
-	pe_free_shallow(action->actions_before);/* action_warpper_t* */
-	pe_free_shallow(action->actions_after); /* action_warpper_t* */	
+	/* Saved actions (id > 0), their node and wrappers belong to
+	 * data_set->arena; unsaved ones were allocated individually
+	 */
+	if(action->actions_before) {
+	    g_ptr_array_free(action->actions_before, TRUE);
+	}
+	if(action->actions_after) {
+	    g_ptr_array_free(action->actions_after, TRUE);
+	}
+	action->actions_before = NULL;
+	action->actions_after = NULL;
 	if(action->extra) {
 	    g_hash_table_destroy(action->extra);
+	    action->extra = NULL;
 	}
 	if(action->meta) {
 	    g_hash_table_destroy(action->meta);
+	    action->meta = NULL;
 	}
+	slist_iter(shared, pe_shared_attrs_t, action->shared_meta, lpc,
+		   pe_shared_attrs_unref(shared));
+	g_list_free(action->shared_meta);
+	action->shared_meta = NULL;
 	crm_free(action->task);
 	crm_free(action->uuid);
-	crm_free(action->node);
-	crm_free(action);
+	if(action->id == 0) {
+		crm_free(action->node);
+		crm_free(action);
+	}
+}
+
+pe_shared_attrs_t *
+pe_shared_attrs_new(void)
+{
+	pe_shared_attrs_t *shared = NULL;
+	crm_malloc0(shared, sizeof(pe_shared_attrs_t));
+	shared->refcount = 1;
+	shared->attrs = g_hash_table_new_full(
+		g_str_hash, g_str_equal, g_hash_destroy_str, g_hash_destroy_str);
+	return shared;
+}
+
+void
+pe_shared_attrs_unref(pe_shared_attrs_t *shared)
+{
+	if(shared == NULL) {
+		return;
+	}
+	CRM_CHECK(shared->refcount > 0, return);
+	if(--shared->refcount == 0) {
+		g_hash_table_destroy(shared->attrs);
+		crm_free(shared);
+	}
+}
+
+/* Attach 'shared' to the action's meta attributes without copying it
+ * Like add_hash_param(), values already set on the action take precedence
+ */
+void
+add_shared_meta(action_t *action, pe_shared_attrs_t *shared)
+{
+	CRM_CHECK(action != NULL && shared != NULL, return);
+	if(g_list_find(action->shared_meta, shared) != NULL) {
+		return;
+	}
+	shared->refcount++;
+	action->shared_meta = g_list_append(action->shared_meta, shared);
 }
 
 GListPtr
@@ -1054,12 +1263,23 @@ find_recurring_actions(GListPtr input, node_t *not_on_node)
 }
 
 action_t *
-find_first_action(GListPtr input, const char *uuid, const char *task, node_t *on_node)
+find_first_action(pe_action_index_t *index, const char *uuid, const char *task, node_t *on_node)
 {
+	GListPtr bucket = NULL;
 	CRM_CHECK(uuid || task, return NULL);
+
+	if(index == NULL) {
+		return NULL;
+
+	} else if(uuid != NULL) {
+		bucket = lookup_bucket(index->by_key, uuid);
+
+	} else {
+		bucket = lookup_bucket(index->by_task, task);
+	}
 	
 	slist_iter(
-		action, action_t, input, lpc,
+		action, action_t, bucket, lpc,
 		if(uuid != NULL && safe_str_neq(uuid, action->uuid)) {
 			continue;
 			
@@ -1081,13 +1301,18 @@ find_first_action(GListPtr input, const char *uuid, const char *task, node_t *on
 }
 
 GListPtr
-find_actions(GListPtr input, const char *key, node_t *on_node)
+find_actions(pe_action_index_t *index, const char *key, node_t *on_node)
 {
 	GListPtr result = NULL;
+	GListPtr bucket = NULL;
 	CRM_CHECK(key != NULL, return NULL);
+
+	if(index != NULL) {
+		bucket = lookup_bucket(index->by_key, key);
+	}
 	
 	slist_iter(
-		action, action_t, input, lpc,
+		action, action_t, bucket, lpc,
 		crm_debug_5("Matching %s against %s", key, action->uuid);
 		if(safe_str_neq(key, action->uuid)) {
 			continue;
@@ -1102,7 +1327,7 @@ find_actions(GListPtr input, const char *key, node_t *on_node)
 				    " it to the requested node...",
 				    key, on_node->details->uname);
 
-			action->node = node_copy(on_node);
+			action->node = node_copy_for(on_node, pe_dataset);
 			result = g_list_append(result, action);
 			
 		} else if(on_node->details == action->node->details) {
@@ -1115,13 +1340,18 @@ find_actions(GListPtr input, const char *key, node_t *on_node)
 
 
 GListPtr
-find_actions_exact(GListPtr input, const char *key, node_t *on_node)
+find_actions_exact(pe_action_index_t *index, const char *key, node_t *on_node)
 {
 	GListPtr result = NULL;
+	GListPtr bucket = NULL;
 	CRM_CHECK(key != NULL, return NULL);
+
+	if(index != NULL) {
+		bucket = lookup_bucket(index->by_key, key);
+	}
 	
 	slist_iter(
-		action, action_t, input, lpc,
+		action, action_t, bucket, lpc,
 		crm_debug_5("Matching %s against %s", key, action->uuid);
 		if(safe_str_neq(key, action->uuid)) {
 			crm_debug_3("Key mismatch: %s vs. %s",
@@ -1144,6 +1374,183 @@ find_actions_exact(GListPtr input, const char *key, node_t *on_node)
 	return result;
 }
 
+/* The actions sharing a key (or task), in creation order so that
+ * lookups return the same action a list scan would have
+ */
+typedef struct action_bucket_s 
+{
+	GListPtr head;
+	GListPtr tail;
+} action_bucket_t;
+
+static void
+free_action_bucket(gpointer data)
+{
+	action_bucket_t *bucket = data;
+	g_list_free(bucket->head);
+	crm_free(bucket);
+}
+
+static GListPtr
+lookup_bucket(GHashTable *table, const char *key)
+{
+	action_bucket_t *bucket = NULL;
+
+	if(table == NULL) {
+		return NULL;
+	}
+	bucket = g_hash_table_lookup(table, key);
+	return bucket?bucket->head:NULL;
+}
+
+static void
+add_to_bucket(GHashTable *table, const char *key, action_t *action)
+{
+	GListPtr lpc = NULL;
+	action_bucket_t *bucket = NULL;
+
+	if(table == NULL || key == NULL) {
+		return;
+	}
+	
+	bucket = g_hash_table_lookup(table, key);
+	if(bucket == NULL) {
+		crm_malloc0(bucket, sizeof(action_bucket_t));
+		g_hash_table_insert(table, crm_strdup(key), bucket);
+	}
+
+	/* New actions have the highest id, so they almost always go
+	 * last.  Only actions renamed after creation need a search.
+	 */
+	for(lpc = bucket->tail; lpc != NULL; lpc = lpc->prev) {
+		action_t *other = lpc->data;
+		if(other->id < action->id) {
+			break;
+		}
+	}
+
+	if(lpc == NULL) {
+		bucket->head = g_list_prepend(bucket->head, action);
+		if(bucket->tail == NULL) {
+			bucket->tail = bucket->head;
+		}
+
+	} else if(lpc == bucket->tail) {
+		bucket->tail = g_list_append(bucket->tail, action)->next;
+
+	} else {
+		/* inserts after lpc, the head can't change */
+		g_list_insert_before(bucket->head, lpc->next, action);
+	}
+}
+
+static void
+remove_from_bucket(GHashTable *table, const char *key, action_t *action)
+{
+	GListPtr link = NULL;
+	action_bucket_t *bucket = NULL;
+
+	if(table == NULL || key == NULL) {
+		return;
+	}
+
+	bucket = g_hash_table_lookup(table, key);
+	if(bucket == NULL) {
+		return;
+	}
+
+	link = g_list_find(bucket->head, action);
+	if(link == NULL) {
+		return;
+
+	} else if(link == bucket->tail) {
+		bucket->tail = link->prev;
+	}
+	bucket->head = g_list_delete_link(bucket->head, link);
+
+	if(bucket->head == NULL) {
+		g_hash_table_remove(table, key);
+	}
+}
+
+/* The working set's index is only ever searched by key */
+static void
+index_action(pe_action_index_t **index, action_t *action, gboolean by_task)
+{
+	if(*index == NULL) {
+		crm_malloc0(*index, sizeof(pe_action_index_t));
+		(*index)->by_key = g_hash_table_new_full(
+			g_str_hash, g_str_equal, g_hash_destroy_str, free_action_bucket);
+		if(by_task) {
+			(*index)->by_task = g_hash_table_new_full(
+				g_str_hash, g_str_equal,
+				g_hash_destroy_str, free_action_bucket);
+		}
+	}
+
+	add_to_bucket((*index)->by_key, action->uuid, action);
+	add_to_bucket((*index)->by_task, action->task, action);
+}
+
+static void
+unindex_action(pe_action_index_t *index, action_t *action)
+{
+	if(index == NULL) {
+		return;
+	}
+	remove_from_bucket(index->by_key, action->uuid, action);
+	remove_from_bucket(index->by_task, action->task, action);
+}
+
+void
+pe_free_action_index(pe_action_index_t *index)
+{
+	if(index == NULL) {
+		return;
+	}
+	g_hash_table_destroy(index->by_key);
+	if(index->by_task != NULL) {
+		g_hash_table_destroy(index->by_task);
+	}
+	crm_free(index);
+}
+
+/* Change the task and/or key of an action that may already have been
+ * saved, keeping the action indexes in sync.
+ * Takes ownership of 'uuid' (which may be NULL to leave it unchanged)
+ */
+void
+rename_action(action_t *action, const char *task, char *uuid,
+	      pe_working_set_t *data_set)
+{
+	gboolean indexed = FALSE;
+	CRM_CHECK(action != NULL, return);
+
+	if(action->id > 0) {
+		indexed = TRUE;
+		unindex_action(data_set->action_index, action);
+		if(action->rsc != NULL) {
+			unindex_action(action->rsc->action_index, action);
+		}
+	}
+
+	if(task != NULL) {
+		crm_free(action->task);
+		action->task = crm_strdup(task);
+	}
+	if(uuid != NULL) {
+		crm_free(action->uuid);
+		action->uuid = uuid;
+	}
+
+	if(indexed) {
+		index_action(&(data_set->action_index), action, FALSE);
+		if(action->rsc != NULL) {
+			index_action(&(action->rsc->action_index), action, TRUE);
+		}
+	}
+}
+
 void
 set_id(xmlNode * xml_obj, const char *prefix, int child) 
 {
@@ -1398,6 +1805,78 @@ struct fail_search
 };
 
 
+typedef struct fail_summary_s 
+{
+	int count;
+	long long last;
+} fail_summary_t;
+
+static fail_summary_t *
+find_fail_summary(GHashTable *index, const char *rsc_id, int len)
+{
+    char *prefix = NULL;
+    fail_summary_t *summary = NULL;
+
+    crm_malloc0(prefix, len + 1);
+    memcpy(prefix, rsc_id, len);
+
+    summary = g_hash_table_lookup(index, prefix);
+    if(summary == NULL) {
+	crm_malloc0(summary, sizeof(fail_summary_t));
+	g_hash_table_insert(index, prefix, summary);
+    } else {
+	crm_free(prefix);
+    }
+    return summary;
+}
+
+static void index_failcount_attr(gpointer key_p, gpointer value, gpointer user_data)
+{
+    int lpc = 0;
+    int count = 0;
+    long long last = 0;
+    const char *rsc_id = NULL;
+    const char *key = key_p;
+    GHashTable *index = user_data;
+
+    if(strstr(key, "fail-count-") == key) {
+	rsc_id = key + 11;
+	count = char2score(value);
+
+    } else if(strstr(key, "last-failure-") == key) {
+	rsc_id = key + 13;
+	last = crm_int_helper(value, NULL);
+
+    } else {
+	return;
+    }
+
+    /* file it under every prefix a stripped clone instance id could take */
+    for(lpc = 0; rsc_id[lpc] != 0; lpc++) {
+	if(rsc_id[lpc] == ':') {
+	    fail_summary_t *summary = find_fail_summary(index, rsc_id, lpc+1);
+	    summary->count += count;
+	    if(last > summary->last) {
+		summary->last = last;
+	    }
+	}
+    }
+}
+
+/* Called whenever the node's attributes are (re)unpacked so that
+ * get_failcount() doesn't need to scan them for anonymous clones
+ */
+void index_failcounts(node_t *node)
+{
+    if(node->details->failcounts != NULL) {
+	g_hash_table_destroy(node->details->failcounts);
+    }
+    node->details->failcounts = g_hash_table_new_full(
+	g_str_hash, g_str_equal, g_hash_destroy_str, g_hash_destroy_str);
+    g_hash_table_foreach(node->details->attrs, index_failcount_attr,
+			 node->details->failcounts);
+}
+
 static void get_failcount_by_prefix(gpointer key_p, gpointer value, gpointer user_data)
 {
     struct fail_search *search = user_data;
@@ -1433,7 +1912,20 @@ int get_failcount(node_t *node, resource_t *rsc, int *last_failure, pe_working_s
 	    }
 	}
 
-	g_hash_table_foreach(node->details->attrs, get_failcount_by_prefix, &search);
+	if(lpc > 0 && node->details->failcounts != NULL) {
+	    fail_summary_t *summary = g_hash_table_lookup(
+		node->details->failcounts, search.key);
+	    if(summary != NULL) {
+		search.count = summary->count;
+		search.last = summary->last;
+	    }
+
+	} else {
+	    /* No incarnation to strip: any attribute starting with
+	     * the id is a match, which the index can't answer
+	     */
+	    g_hash_table_foreach(node->details->attrs, get_failcount_by_prefix, &search);
+	}
 
     } else {
 	/* Optimize the "normal" case */
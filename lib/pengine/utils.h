@@ -25,10 +25,13 @@ extern pe_working_set_t *pe_dataset;
 extern node_t *node_copy(node_t *this_node) ;
 extern time_t get_timet_now(pe_working_set_t *data_set);
 extern int get_failcount(node_t *node, resource_t *rsc, int *last_failure, pe_working_set_t *data_set);
+extern void index_failcounts(node_t *node);
 
 /* Binary like operators for lists of nodes */
 extern GListPtr node_list_exclude(GListPtr list1, GListPtr list2, gboolean merge_scores);
 extern GListPtr node_list_dup(GListPtr list1, gboolean reset, gboolean filter);
+extern node_t **node_list_vector(GListPtr list, int *size);
+extern node_t *node_vector_find(node_t **vector, int size, const node_t *node);
 
 extern GListPtr node_list_and(GListPtr list1, GListPtr list2, gboolean filter);
 
@@ -40,6 +43,9 @@ extern gboolean node_list_eq(GListPtr list1, GListPtr list2, gboolean filter);
 
 extern GListPtr node_list_or(GListPtr list1, GListPtr list2, gboolean filter);
 
+extern void *pe_arena_alloc(pe_working_set_t *data_set, size_t size);
+extern void pe_free_arena(pe_arena_t *arena);
+
 extern void pe_free_shallow(GListPtr alist);
 extern void pe_free_shallow_adv(GListPtr alist, gboolean with_data);
 
@@ -110,21 +116,35 @@ extern action_t *custom_action(
 		rsc, demoted_key(rsc), CRMD_ACTION_DEMOTED, node,	\
 		optional, TRUE, data_set)
 
-extern action_t *find_first_action(GListPtr input, const char *uuid, const char *task, node_t *on_node);
+extern action_t *find_first_action(pe_action_index_t *index, const char *uuid, const char *task, node_t *on_node);
 
-extern GListPtr find_actions(GListPtr input, const char *key, node_t *on_node);
+extern GListPtr find_actions(pe_action_index_t *index, const char *key, node_t *on_node);
 extern GListPtr find_actions_exact(
-	GListPtr input, const char *key, node_t *on_node);
+	pe_action_index_t *index, const char *key, node_t *on_node);
 extern GListPtr find_recurring_actions(GListPtr input, node_t *not_on_node);
 
 extern void set_id(xmlNode *xml_obj, const char *prefix, int child);
 extern void pe_free_action(action_t *action);
 
+extern pe_shared_attrs_t *pe_shared_attrs_new(void);
+extern void pe_shared_attrs_unref(pe_shared_attrs_t *shared);
+extern void add_shared_meta(action_t *action, pe_shared_attrs_t *shared);
+extern void pe_free_action_index(pe_action_index_t *index);
+extern void rename_action(
+	action_t *action, const char *task, char *uuid, pe_working_set_t *data_set);
+
 extern void
 resource_location(resource_t *rsc, node_t *node, int score, const char *tag,
 		  pe_working_set_t *data_set);
 
 extern gint sort_op_by_callid(gconstpointer a, gconstpointer b);
+
+extern void pe_index_node(node_t *node, pe_working_set_t *data_set);
+extern void pe_index_resource(resource_t *rsc, pe_working_set_t *data_set);
+extern void pe_set_clone_name(
+	resource_t *rsc, const char *name, pe_working_set_t *data_set);
+extern resource_t *pe_find_indexed_resource(
+	pe_working_set_t *data_set, const char *id, resource_t *within, gboolean renamed);
 extern gboolean get_target_role(resource_t *rsc, enum rsc_role_e *role);
 
 #endif
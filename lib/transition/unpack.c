@@ -87,6 +87,97 @@ unpack_action(synapse_t *parent, xmlNode *xml_action)
 	return action;
 }
 
+/* An input sent by id only, see resolve_input_refs() */
+static crm_action_t*
+unpack_input_ref(synapse_t *parent, int id) 
+{
+	crm_action_t *input = NULL;
+
+	crm_malloc0(input, sizeof(crm_action_t));
+	input->id = id;
+	input->type = action_type_rsc;
+	input->synapse = parent;
+	input->params = g_hash_table_new_full(
+		g_str_hash, g_str_equal, g_hash_destroy_str, g_hash_destroy_str);
+	return input;
+}
+
+static void
+unpack_input_refs(synapse_t *synapse, const char *refs) 
+{
+	char *end = NULL;
+	const char *pos = refs;
+
+	while(pos != NULL && *pos != EOS) {
+		long id = strtol(pos, &end, 10);
+		if(end == pos) {
+			crm_err("Bad input reference in synapse %d: %s",
+				synapse->id, refs);
+			break;
+		}
+		crm_debug_3("Adding input %ld to synapse %d", id, synapse->id);
+		synapse->inputs = g_list_append(
+			synapse->inputs, unpack_input_ref(synapse, id));
+		pos = end;
+	}
+}
+
+/* Give inputs sent by id the same details they would have been sent with */
+static void
+resolve_input_refs(crm_graph_t *graph) 
+{
+	int lpc = 0;
+	const char *attrs[] = {
+		XML_ATTR_ID,
+		XML_LRM_ATTR_TASK,
+		XML_LRM_ATTR_TASK_KEY,
+		XML_LRM_ATTR_TARGET,
+		XML_LRM_ATTR_TARGET_UUID,
+	};
+	GHashTable *actions = g_hash_table_new(g_direct_hash, g_direct_equal);
+	
+	slist_iter(
+		synapse, synapse_t, graph->synapses, lpc1,
+		slist_iter(
+			action, crm_action_t, synapse->actions, lpc2,
+			g_hash_table_insert(
+				actions, GINT_TO_POINTER(action->id), action);
+			);
+		);
+
+	slist_iter(
+		synapse, synapse_t, graph->synapses, lpc1,
+		slist_iter(
+			input, crm_action_t, synapse->inputs, lpc2,
+			crm_action_t *action = NULL;
+
+			if(input->xml != NULL) {
+				continue;
+			}
+
+			action = g_hash_table_lookup(
+				actions, GINT_TO_POINTER(input->id));
+			if(action == NULL) {
+				crm_warn("Input %d of synapse %d is not in the graph",
+					 input->id, synapse->id);
+				input->xml = create_xml_node(NULL, XML_GRAPH_TAG_RSC_OP);
+				crm_xml_add_int(input->xml, XML_ATTR_ID, input->id);
+				continue;
+			}
+
+			input->type = action->type;
+			input->xml = create_xml_node(
+				NULL, crm_element_name(action->xml));
+			for(lpc = 0; lpc < DIMOF(attrs); lpc++) {
+				crm_xml_add(input->xml, attrs[lpc],
+					    crm_element_value(action->xml, attrs[lpc]));
+			}
+			);
+		);
+
+	g_hash_table_destroy(actions);
+}
+
 static synapse_t *
 unpack_synapse(crm_graph_t *new_graph, xmlNode *xml_synapse) 
 {
@@ -135,6 +226,9 @@ unpack_synapse(crm_graph_t *new_graph, xmlNode *xml_synapse)
 	
 	xml_child_iter_filter(
 		xml_synapse, inputs, "inputs",
+
+		unpack_input_refs(new_synapse, crm_element_value(
+					  inputs, XML_GRAPH_ATTR_INPUT_REFS));
 		
 		xml_child_iter(
 			inputs, trigger, 
@@ -222,6 +316,8 @@ unpack_graph(xmlNode *xml_graph, const char *reference)
 		}
 		);
 
+	resolve_input_refs(new_graph);
+
 	crm_info("Unpacked transition %d: %d actions in %d synapses",
 		 new_graph->id, new_graph->num_actions,new_graph->num_synapses);
 
@@ -174,8 +174,7 @@ static void CancelXmlOp(resource_t *rsc, xmlNode *xml_op, node_t *active_node,
     cancel = custom_action(rsc, crm_strdup(key), RSC_CANCEL,
 			   active_node, FALSE, TRUE, data_set);
 
-    crm_free(cancel->task);
-    cancel->task = crm_strdup(RSC_CANCEL);
+    rename_action(cancel, RSC_CANCEL, NULL, data_set);
     
     add_hash_param(cancel->meta, XML_LRM_ATTR_TASK,     task);
     add_hash_param(cancel->meta, XML_LRM_ATTR_CALLID,   call_id);
@@ -186,6 +185,203 @@ static void CancelXmlOp(resource_t *rsc, xmlNode *xml_op, node_t *active_node,
     crm_free(key); key = NULL;
 }
 
+/* Digests of the parameters passed to each operation
+ *
+ * Building, filtering and serializing the parameters for every op in every
+ * node's history is expensive, yet the result rarely changes from one
+ * transition to the next.  Cache the digests by the (sorted) parameters
+ * themselves, plus the op's CRM version and restart list, so that they
+ * survive across PE runs.  Entries not used during a run are dropped at
+ * the end of it.
+ */
+typedef struct op_digest_s 
+{
+	char *digest_all;
+	char *digest_restart;	/* only calculated when needed */
+	int generation;
+} op_digest_t;
+
+static GHashTable *digest_cache = NULL;
+static int digest_generation = 0;
+
+static void
+free_op_digest(gpointer data)
+{
+	op_digest_t *digest = data;
+	crm_free(digest->digest_all);
+	crm_free(digest->digest_restart);
+	crm_free(digest);
+}
+
+static gboolean
+stale_op_digest(gpointer key, gpointer value, gpointer user_data)
+{
+	op_digest_t *digest = value;
+	return digest->generation != digest_generation;
+}
+
+static void
+op_digest_cache_begin(void)
+{
+	if(digest_cache == NULL) {
+		digest_cache = g_hash_table_new_full(
+			g_str_hash, g_str_equal, g_hash_destroy_str, free_op_digest);
+	}
+	digest_generation++;
+}
+
+static void
+op_digest_cache_end(void)
+{
+	int before = g_hash_table_size(digest_cache);
+	g_hash_table_foreach_remove(digest_cache, stale_op_digest, NULL);
+	crm_debug_2("Dropped %d of %d cached operation digests",
+		    before - g_hash_table_size(digest_cache), before);
+}
+
+/* Mirror hash2field(): the first value for any name wins */
+static void
+hash2digest_field(gpointer key, gpointer value, gpointer user_data)
+{
+	GHashTable *fields = user_data;
+	if(value != NULL && g_hash_table_lookup(fields, key) == NULL) {
+		g_hash_table_insert(fields, crm_strdup(key), value);
+	}
+}
+
+static void
+hash2digest_metafield(gpointer key, gpointer value, gpointer user_data)
+{
+	char *crm_name = NULL;
+	if(key == NULL || value == NULL) {
+		return;
+	}
+	crm_name = crm_meta_name(key);
+	hash2digest_field(crm_name, value, user_data);
+	crm_free(crm_name);
+}
+
+static void
+append_digest_name(gpointer key, gpointer value, gpointer user_data)
+{
+	GListPtr *names = user_data;
+	*names = g_list_prepend(*names, key);
+}
+
+static gint
+sort_digest_field(gconstpointer a, gconstpointer b)
+{
+	return strcmp(a, b);
+}
+
+static char *
+op_digest_key(GHashTable *local_rsc_params, action_t *action, resource_t *rsc,
+	      const char *op_version, const char *restart_list)
+{
+	int len = 0;
+	int offset = 0;
+	char *key = NULL;
+	GListPtr names = NULL;
+	GHashTable *fields = g_hash_table_new_full(
+		g_str_hash, g_str_equal, g_hash_destroy_str, NULL);
+
+	/* Same order as check_action_definition() adds them */
+	g_hash_table_foreach(local_rsc_params, hash2digest_field, fields);
+	g_hash_table_foreach(action->extra, hash2digest_field, fields);
+	g_hash_table_foreach(rsc->parameters, hash2digest_field, fields);
+	g_hash_table_foreach(action->meta, hash2digest_metafield, fields);
+
+	op_version = crm_str(op_version);
+	restart_list = crm_str(restart_list);
+	len = strlen(op_version) + strlen(restart_list) + 32;
+
+	g_hash_table_foreach(fields, append_digest_name, &names);
+	names = g_list_sort(names, sort_digest_field);
+	slist_iter(name, const char, names, lpc,
+		   const char *value = g_hash_table_lookup(fields, name);
+		   len += strlen(name) + strlen(value) + 24;
+		);
+
+	/* Length-prefix everything so that no two inputs share a key */
+	crm_malloc0(key, len);
+	offset += sprintf(key + offset, "%d:%s%d:%s",
+			  (int)strlen(op_version), op_version,
+			  (int)strlen(restart_list), restart_list);
+	slist_iter(name, const char, names, lpc,
+		   const char *value = g_hash_table_lookup(fields, name);
+		   offset += sprintf(key + offset, "%d:%s%d:%s",
+				     (int)strlen(name), name, (int)strlen(value), value);
+		);
+
+	g_list_free(names);
+	g_hash_table_destroy(fields);
+	return key;
+}
+
+static xmlNode *
+create_op_params(GHashTable *local_rsc_params, action_t *action, resource_t *rsc,
+		 const char *op_version)
+{
+	xmlNode *params_all = create_xml_node(NULL, XML_TAG_PARAMS);
+	g_hash_table_foreach(local_rsc_params, hash2field, params_all);
+	g_hash_table_foreach(action->extra, hash2field, params_all);
+	g_hash_table_foreach(rsc->parameters, hash2field, params_all);
+	g_hash_table_foreach(action->meta, hash2metafield, params_all);
+
+	filter_action_parameters(params_all, op_version);
+	return params_all;
+}
+
+static xmlNode *
+create_restart_params(xmlNode *params_all, const char *restart_list)
+{
+	xmlNode *params_restart = copy_xml(params_all);
+	if(restart_list) {
+		filter_reload_parameters(params_restart, restart_list);
+	}
+	return params_restart;
+}
+
+static op_digest_t *
+lookup_op_digest(GHashTable *local_rsc_params, action_t *action, resource_t *rsc,
+		 const char *op_version, const char *restart_list, gboolean need_restart)
+{
+	xmlNode *params_all = NULL;
+	xmlNode *params_restart = NULL;
+	op_digest_t *digest = NULL;
+	char *key = op_digest_key(
+		local_rsc_params, action, rsc, op_version, restart_list);
+
+	digest = g_hash_table_lookup(digest_cache, key);
+	if(digest == NULL) {
+		crm_malloc0(digest, sizeof(op_digest_t));
+		g_hash_table_insert(digest_cache, key, digest);
+
+	} else {
+		crm_free(key);
+	}
+
+	digest->generation = digest_generation;
+	if(digest->digest_all != NULL
+	   && (need_restart == FALSE || digest->digest_restart != NULL)) {
+		return digest;
+	}
+
+	params_all = create_op_params(local_rsc_params, action, rsc, op_version);
+	if(digest->digest_all == NULL) {
+		digest->digest_all = calculate_xml_digest(params_all, TRUE, FALSE);
+	}
+
+	if(need_restart) {
+		params_restart = create_restart_params(params_all, restart_list);
+		digest->digest_restart = calculate_xml_digest(params_restart, TRUE, FALSE);
+	}
+
+	free_xml(params_all);
+	free_xml(params_restart);
+	return digest;
+}
+
 static gboolean
 check_action_definition(resource_t *rsc, node_t *active_node, xmlNode *xml_op,
 			pe_working_set_t *data_set)
@@ -200,12 +396,11 @@ check_action_definition(resource_t *rsc, node_t *active_node, xmlNode *xml_op,
 	xmlNode *params_restart = NULL;
 	GHashTable *local_rsc_params = NULL;
 	
-	char *digest_all_calc = NULL;
+	op_digest_t *digest_calc = NULL;
 	const char *digest_all = NULL;
 
 	const char *restart_list = NULL;
 	const char *digest_restart = NULL;
-	char *digest_restart_calc = NULL;
 
 	action_t *action = NULL;
 	const char *task = crm_element_value(xml_op, XML_LRM_ATTR_TASK);
@@ -243,24 +438,15 @@ check_action_definition(resource_t *rsc, node_t *active_node, xmlNode *xml_op,
 	action = custom_action(rsc, key, task, active_node, TRUE, FALSE, data_set);
 	/* key is free'd by custom_action() */
 	
-	local_rsc_params = g_hash_table_new_full(
-		g_str_hash, g_str_equal,
-		g_hash_destroy_str, g_hash_destroy_str);
+	local_rsc_params = get_node_rsc_attributes(rsc, active_node, data_set);
 	
-	get_rsc_attributes(local_rsc_params, rsc, active_node, data_set);
-	
-	params_all = create_xml_node(NULL, XML_TAG_PARAMS);
-	g_hash_table_foreach(local_rsc_params, hash2field, params_all);
-	g_hash_table_foreach(action->extra, hash2field, params_all);
-	g_hash_table_foreach(rsc->parameters, hash2field, params_all);
-	g_hash_table_foreach(action->meta, hash2metafield, params_all);
-
-	filter_action_parameters(params_all, op_version);
-	digest_all_calc = calculate_xml_digest(params_all, TRUE, FALSE);
 	digest_all = crm_element_value(xml_op, XML_LRM_ATTR_OP_DIGEST);
 	digest_restart = crm_element_value(xml_op, XML_LRM_ATTR_RESTART_DIGEST);
 	restart_list = crm_element_value(xml_op, XML_LRM_ATTR_OP_RESTART);
 
+	digest_calc = lookup_op_digest(local_rsc_params, action, rsc, op_version,
+				       restart_list, digest_restart != NULL);
+
     if(interval == 0 && safe_str_eq(task, RSC_STATUS)) {
 	/* Reload based on the start action not a probe */
 	task = RSC_START;
@@ -268,19 +454,16 @@ check_action_definition(resource_t *rsc, node_t *active_node, xmlNode *xml_op,
     
     if(digest_restart) {
 	/* Changes that force a restart */
-		params_restart = copy_xml(params_all);
-		if(restart_list) {
-			filter_reload_parameters(params_restart, restart_list);
-		}
-
-		digest_restart_calc = calculate_xml_digest(params_restart, TRUE, FALSE);
-		if(safe_str_neq(digest_restart_calc, digest_restart)) {
+		if(safe_str_neq(digest_calc->digest_restart, digest_restart)) {
 			did_change = TRUE;
 			key = generate_op_key(rsc->id, task, interval);
+			params_all = create_op_params(
+				local_rsc_params, action, rsc, op_version);
+			params_restart = create_restart_params(params_all, restart_list);
 			crm_log_xml_info(params_restart, "params:restart");
 	    crm_info("Parameters to %s on %s changed: recorded %s vs. %s (restart:%s) %s",
 				 key, active_node->details->uname,
-				 crm_str(digest_restart), digest_restart_calc,
+				 crm_str(digest_restart), digest_calc->digest_restart,
 				 op_version, crm_element_value(xml_op, XML_ATTR_TRANSITION_MAGIC));
 			
 			custom_action(rsc, key, task, NULL, FALSE, TRUE, data_set);
@@ -288,14 +471,16 @@ check_action_definition(resource_t *rsc, node_t *active_node, xmlNode *xml_op,
 		}
 	}
 
-	if(safe_str_neq(digest_all_calc, digest_all)) {
+	if(safe_str_neq(digest_calc->digest_all, digest_all)) {
 	/* Changes that can potentially be handled by a reload */
 		did_change = TRUE;
+		params_all = create_op_params(
+			local_rsc_params, action, rsc, op_version);
 		crm_log_xml_info(params_all, "params:reload");
 		key = generate_op_key(rsc->id, task, interval);
 		crm_info("Parameters to %s on %s changed: recorded %s vs. %s (reload:%s) %s",
 			 key, active_node->details->uname,
-			 crm_str(digest_all), digest_all_calc, op_version,
+			 crm_str(digest_all), digest_calc->digest_all, op_version,
 			 crm_element_value(xml_op, XML_ATTR_TRANSITION_MAGIC));
 
 	if(interval > 0) {
@@ -333,9 +518,6 @@ check_action_definition(resource_t *rsc, node_t *active_node, xmlNode *xml_op,
   cleanup:
 	free_xml(params_all);
 	free_xml(params_restart);
-	crm_free(digest_all_calc);
-	crm_free(digest_restart_calc);
-	g_hash_table_destroy(local_rsc_params);
 
 	pe_free_action(action);
 	
@@ -486,7 +668,7 @@ check_actions(pe_working_set_t *data_set)
 	lrm_rscs = find_xml_node(node_state, XML_CIB_TAG_LRM, FALSE);
 	lrm_rscs = find_xml_node(lrm_rscs, XML_LRM_TAG_RESOURCES, FALSE);
 
-	node = pe_find_node_id(data_set->nodes, id);
+	node = pe_lookup_node_id(data_set, id);
 
 	if(node == NULL) {
 	    continue;
@@ -715,6 +897,7 @@ stage0(pe_working_set_t *data_set)
 	}
 
 	cluster_status(data_set);
+	stage_stats_mark("unpack", data_set);
 	
 	set_alloc_actions(data_set);
 	apply_system_health(data_set);
@@ -878,7 +1061,9 @@ stage3(pe_working_set_t *data_set)
 gboolean
 stage4(pe_working_set_t *data_set)
 {
+	op_digest_cache_begin();
 	check_actions(data_set);
+	op_digest_cache_end();
 	return TRUE;
 }
 
@@ -1033,7 +1218,7 @@ stage6(pe_working_set_t *data_set)
 	
 	if(dc_down != NULL) {
 		GListPtr shutdown_matches = find_actions(
-			data_set->actions, CRM_OP_SHUTDOWN, NULL);
+			data_set->action_index, CRM_OP_SHUTDOWN, NULL);
 		crm_debug_2("Ordering shutdowns before %s on %s (DC)",
 			dc_down->task, dc_down->node->details->uname);
 
@@ -1142,9 +1327,17 @@ sort_notify_entries(gconstpointer a, gconstpointer b)
 	return strcmp(entry_a->node->details->id, entry_b->node->details->id);
 }
 
+/* Only the first of any run of entries for the same resource is listed */
+#define skip_notify_entry(entry, node_list, last_rsc_id)		\
+	((entry) == NULL || (entry)->rsc == NULL			\
+	 || ((node_list) != NULL && (entry)->node == NULL)		\
+	 || safe_str_eq((entry)->rsc->id, (last_rsc_id)))
+
 static void
 expand_list(GListPtr list, char **rsc_list, char **node_list)
 {
+	int rsc_len = 0;
+	int node_len = 0;
 	const char *uname = NULL;
 	const char *rsc_id = NULL;
 	const char *last_rsc_id = NULL;
@@ -1161,7 +1354,29 @@ expand_list(GListPtr list, char **rsc_list, char **node_list)
 	if(node_list) {
 	    *node_list = NULL;
 	}
+
+	/* Size both lists first so each is allocated exactly once */
+	slist_iter(entry, notify_entry_t, list, lpc,
+		   if(skip_notify_entry(entry, node_list, last_rsc_id)) {
+			   continue;
+		   }
+		   last_rsc_id = entry->rsc->id;
+		   rsc_len += strlen(last_rsc_id) + 1;
+		   if(node_list != NULL && entry->node->details->uname) {
+			   node_len += strlen(entry->node->details->uname) + 1;
+		   }
+		);
+
+	if(rsc_len > 0) {
+	    crm_malloc0(*rsc_list, rsc_len + 1);
+	    rsc_len = 0;
+	}
+	if(node_len > 0) {
+	    crm_malloc0(*node_list, node_len + 1);
+	    node_len = 0;
+	}
 	
+	last_rsc_id = NULL;
 	slist_iter(entry, notify_entry_t, list, lpc,
 
 		   CRM_CHECK(entry != NULL, continue);
@@ -1178,34 +1393,16 @@ expand_list(GListPtr list, char **rsc_list, char **node_list)
 		   }
 		   last_rsc_id = rsc_id;
 
-		   if(rsc_list != NULL) {
-			   int existing_len = 0;
-			   int len = 2 + strlen(rsc_id); /* +1 space, +1 EOS */
-			   if(rsc_list && *rsc_list) {
-				   existing_len = strlen(*rsc_list);
-			   }
-
-			   crm_debug_5("Adding %s (%dc) at offset %d",
-				       rsc_id, len-2, existing_len);
-			   crm_realloc(*rsc_list, len + existing_len);
-			   sprintf(*rsc_list + existing_len, "%s ", rsc_id);
-		   }
+		   crm_debug_5("Adding %s at offset %d", rsc_id, rsc_len);
+		   rsc_len += sprintf(*rsc_list + rsc_len, "%s ", rsc_id);
 
 		   if(entry->node != NULL) {
 		       uname = entry->node->details->uname;
 		   }
 		   
 		   if(node_list != NULL && uname) {
-			   int existing_len = 0;
-			   int len = 2 + strlen(uname);
-			   if(node_list && *node_list) {
-				   existing_len = strlen(*node_list);
-			   }
-			   
-			   crm_debug_5("Adding %s (%dc) at offset %d",
-				       uname, len-2, existing_len);
-			   crm_realloc(*node_list, len + existing_len);
-			   sprintf(*node_list + existing_len, "%s ", uname);
+			   crm_debug_5("Adding %s at offset %d", uname, node_len);
+			   node_len += sprintf(*node_list + node_len, "%s ", uname);
 		   }
 		   );
 }
@@ -1249,7 +1446,7 @@ pe_notify(resource_t *rsc, node_t *node, action_t *op, action_t *confirm,
 	trigger = custom_action(rsc, key, op->task, node,
 				op->optional, TRUE, data_set);
 	g_hash_table_foreach(op->meta, dup_attr, trigger->meta);
-	g_hash_table_foreach(n_data->keys, dup_attr, trigger->meta);
+	add_shared_meta(trigger, n_data->keys);
 			
 	/* pseudo_notify before notify */
 	crm_debug_3("Ordering %s before %s (%d->%d)",
@@ -1317,8 +1514,7 @@ create_notification_boundaries(
 
     crm_malloc0(n_data, sizeof(notify_data_t));
     n_data->action = action;
-    n_data->keys = g_hash_table_new_full(
-	g_str_hash, g_str_equal, g_hash_destroy_str, g_hash_destroy_str);
+    n_data->keys = pe_shared_attrs_new();
     
     if(start) {
 	/* create pre-event notification wrappers */
@@ -1486,8 +1682,8 @@ expand_notification_data(notify_data_t *n_data)
 	    required = TRUE;
 	}
     }
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_stop_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_stop_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_stop_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_stop_uname"), node_list);
 	    
     if(n_data->start) {
 	n_data->start = g_list_sort(n_data->start, sort_notify_entries);
@@ -1496,8 +1692,8 @@ expand_notification_data(notify_data_t *n_data)
 	}
     }
     expand_list(n_data->start, &rsc_list, &node_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_start_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_start_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_start_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_start_uname"), node_list);
 	    
     if(n_data->demote) {
 	n_data->demote = g_list_sort(n_data->demote, sort_notify_entries);
@@ -1507,8 +1703,8 @@ expand_notification_data(notify_data_t *n_data)
     }
 
     expand_list(n_data->demote, &rsc_list, &node_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_demote_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_demote_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_demote_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_demote_uname"), node_list);
 	    
     if(n_data->promote) {
 	n_data->promote = g_list_sort(n_data->promote, sort_notify_entries);
@@ -1517,35 +1713,35 @@ expand_notification_data(notify_data_t *n_data)
 	}
     }
     expand_list(n_data->promote, &rsc_list, &node_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_promote_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_promote_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_promote_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_promote_uname"), node_list);
 	    
     if(n_data->active) {
 	n_data->active = g_list_sort(n_data->active, sort_notify_entries);
     }
     expand_list(n_data->active, &rsc_list, &node_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_active_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_active_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_active_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_active_uname"), node_list);
 	    
     if(n_data->slave) {
 	n_data->slave = g_list_sort(n_data->slave, sort_notify_entries);
     }
     expand_list(n_data->slave, &rsc_list, &node_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_slave_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_slave_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_slave_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_slave_uname"), node_list);
 	    
     if(n_data->master) {
 	n_data->master = g_list_sort(n_data->master, sort_notify_entries);
     }
     expand_list(n_data->master, &rsc_list, &node_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_master_resource"), rsc_list);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_master_uname"), node_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_master_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_master_uname"), node_list);
 	    
     if(n_data->inactive) {
 	n_data->inactive = g_list_sort(n_data->inactive, sort_notify_entries);
     }
     expand_list(n_data->inactive, &rsc_list, NULL);
-    g_hash_table_insert(n_data->keys, crm_strdup("notify_inactive_resource"), rsc_list);
+    g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_inactive_resource"), rsc_list);
 
     if(required && n_data->pre) {
 	n_data->pre->optional = FALSE;
@@ -1585,7 +1781,7 @@ create_notifications(resource_t *rsc, notify_data_t *n_data, pe_working_set_t *d
 		case stop_rsc:
 		case action_promote:
 		case action_demote:
-		    g_hash_table_foreach(n_data->keys, dup_attr, op->meta);
+		    add_shared_meta(op, n_data->keys);
 		    break;
 		default:
 		    break;
@@ -1596,8 +1792,8 @@ create_notifications(resource_t *rsc, notify_data_t *n_data, pe_working_set_t *d
     crm_debug_2("Creating notificaitons for: %s.%s (%s->%s)",
 		n_data->action, rsc->id, role2text(rsc->role), role2text(rsc->next_role));
     
-    stop = find_first_action(rsc->actions, NULL, RSC_STOP, NULL);
-    start = find_first_action(rsc->actions, NULL, RSC_START, NULL);
+    stop = find_first_action(rsc->action_index, NULL, RSC_STOP, NULL);
+    start = find_first_action(rsc->action_index, NULL, RSC_START, NULL);
 	
     /* stop / demote */
     if(rsc->role != RSC_ROLE_STOPPED) {
@@ -1639,7 +1835,7 @@ void free_notification_data(notify_data_t *n_data)
     pe_free_shallow(n_data->slave);
     pe_free_shallow(n_data->active);
     pe_free_shallow(n_data->inactive);
-    g_hash_table_destroy(n_data->keys);
+    pe_shared_attrs_unref(n_data->keys);
     crm_free(n_data);
 }
 
@@ -1716,14 +1912,17 @@ cleanup_alloc_calculations(pe_working_set_t *data_set)
 	crm_debug_3("deleting order cons: %p", data_set->ordering_constraints);
 	pe_free_ordering(data_set->ordering_constraints);
 	data_set->ordering_constraints = NULL;
+	data_set->ordering_tail = NULL;
 	
 	crm_debug_3("deleting node cons: %p", data_set->placement_constraints);
 	pe_free_rsc_to_node(data_set->placement_constraints);
 	data_set->placement_constraints = NULL;
+	data_set->placement_tail = NULL;
 
 	crm_debug_3("deleting inter-resource cons: %p", data_set->colocation_constraints);
-  	pe_free_shallow(data_set->colocation_constraints);
+	g_list_free(data_set->colocation_constraints); /* in data_set->arena */
 	data_set->colocation_constraints = NULL;
+	data_set->colocation_tail = NULL;
 	
 	cleanup_calculations(data_set);
 }
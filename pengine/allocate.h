@@ -56,6 +56,14 @@ struct resource_alloc_functions_s
 
 extern GListPtr rsc_merge_weights(
     resource_t *rsc, const char *rhs, GListPtr nodes, const char *attr, int factor, gboolean allow_rollback, gboolean only_positive);
+extern void rsc_merge_weights_cache_begin(void);
+extern void rsc_merge_weights_cache_end(void);
+extern void rsc_merge_weights_cache_flush(void);
+
+typedef struct clone_sort_key_s clone_sort_key_t;
+extern clone_sort_key_t *new_clone_sort_key(resource_t *rsc);
+extern void free_clone_sort_key(clone_sort_key_t *key);
+extern gint sort_clone_key(gconstpointer a, gconstpointer b);
 
 extern node_t * native_color(resource_t *rsc, pe_working_set_t *data_set);
 extern void native_create_actions(
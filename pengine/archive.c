@@ -0,0 +1,516 @@
+/*
+ * Copyright (C) 2004 Andrew Beekhof <andrew@beekhof.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <crm_internal.h>
+
+#include <sys/param.h>
+#include <sys/stat.h>
+
+#include <crm/crm.h>
+#include <crm/msg_xml.h>
+#include <crm/common/xml.h>
+
+#include <glib.h>
+
+#include <pengine.h>
+
+#if HAVE_BZLIB_H
+#  include <bzlib.h>
+#endif
+#if HAVE_PTHREAD_H && HAVE_LIBPTHREAD
+#  include <pthread.h>
+#  define ARCHIVE_THREADS 1
+#else
+#  define ARCHIVE_THREADS 0
+#endif
+
+/* Saving PE inputs
+ *
+ * Compressing, writing and fsync'ing every input used to hold up the
+ * reply to the next PECALC.  The input is still formatted here, on
+ * the main thread (which owns libxml2), but the rest is handed to a
+ * single writer thread.  Jobs are written in the order they were
+ * queued, and each input is on disk before the series file that
+ * points past it.  The writer doesn't log; failures are reported the
+ * next time the main thread looks at the queue.
+ *
+ * If keyframes are enabled, only every Nth input is saved in full.
+ * The others contain just the changes since the previous input in the
+ * series, and filename2xml() puts them back together.  Once an input
+ * can't be saved, the writer skips any deltas already queued against it
+ * until the next input in that series is saved in full.
+ */
+
+#define PE_ARCHIVE_QUEUE_MAX 8
+
+typedef struct archive_job_s
+{
+	char *filename;
+	char *buffer;
+	int level;		/* bzip2 block size, zero to write plain text */
+
+	char *series_file;	/* NULL to leave the series alone */
+	int sequence;
+	char *base;		/* the input a delta needs, NULL if saved in full */
+
+	int rc;			/* errno of the failure */
+	const char *failed;	/* what failed, NULL on success */
+	gboolean skipped;	/* not written, because 'base' wasn't */
+
+	struct archive_job_s *next;
+} archive_job_t;
+
+/* Jobs that couldn't be saved, newest first.
+ * Not a GList, glib isn't thread-safe here without g_thread_init()
+ */
+static archive_job_t *archive_failed = NULL;
+
+/* What each series' next delta is based on, main thread only */
+typedef struct archive_series_s
+{
+	xmlNode *last_input;
+	char *last_file;	/* without the directory */
+	int deltas;		/* since last_input was saved in full */
+} archive_series_t;
+
+static GHashTable *archive_series = NULL;
+
+/* Series whose last input wasn't saved, writer only */
+typedef struct archive_broken_s
+{
+	char *series_file;
+	struct archive_broken_s *next;
+} archive_broken_t;
+
+static archive_broken_t *archive_broken = NULL;
+
+static void
+free_archive_series(gpointer data)
+{
+	archive_series_t *a_series = data;
+	free_xml(a_series->last_input);
+	crm_free(a_series->last_file);
+	crm_free(a_series);
+}
+
+static void
+free_archive_job(archive_job_t *job)
+{
+	if(job == NULL) {
+		return;
+	}
+	crm_free(job->filename);
+	crm_free(job->buffer);
+	crm_free(job->series_file);
+	crm_free(job->base);
+	crm_free(job);
+}
+
+static gboolean
+archive_fail(archive_job_t *job, const char *failed)
+{
+	if(job->failed == NULL) {
+		job->rc = errno;
+		job->failed = failed;
+	}
+	return FALSE;
+}
+
+/* No logging in here, it can run on the writer thread */
+static gboolean
+write_archive_file(archive_job_t *job)
+{
+	int rc = 0;
+	FILE *output = fopen(job->filename, "w");
+
+	if(output == NULL) {
+		return archive_fail(job, "open");
+	}
+	fchmod(fileno(output), S_IRUSR|S_IWUSR);
+
+#if HAVE_BZLIB_H
+	if(job->level > 0) {
+		int bz_rc = BZ_OK;
+		BZFILE *bz_file = BZ2_bzWriteOpen(
+			&bz_rc, output, job->level, 0, 30);
+		if(bz_rc == BZ_OK) {
+			BZ2_bzWrite(&bz_rc, bz_file, job->buffer, strlen(job->buffer));
+		}
+		if(bz_rc == BZ_OK) {
+			BZ2_bzWriteClose(&bz_rc, bz_file, 0, NULL, NULL);
+		}
+		if(bz_rc != BZ_OK) {
+			errno = EIO;
+			archive_fail(job, "compress");
+		}
+	} else
+#endif
+	if(fprintf(output, "%s", job->buffer) < 0) {
+		archive_fail(job, "write");
+	}
+
+	if(fflush(output) != 0) {
+		archive_fail(job, "flush");
+	}
+	if(fsync(fileno(output)) < 0) {
+		archive_fail(job, "sync");
+	}
+	fclose(output);
+
+	if(job->series_file != NULL) {
+		/* Only once the input it refers to is safely on disk */
+		output = fopen(job->series_file, "w");
+		if(output == NULL) {
+			return archive_fail(job, "open the series file for");
+
+		} else if(fprintf(output, "%d", job->sequence) < 0) {
+			rc = -1;
+		}
+		if(fflush(output) != 0) {
+			rc = -1;
+		}
+		fclose(output);
+		if(rc < 0) {
+			archive_fail(job, "update the series file for");
+		}
+	}
+	return job->failed == NULL;
+}
+
+/* No logging in here either */
+static gboolean
+save_archive_job(archive_job_t *job)
+{
+	archive_broken_t **broken = &archive_broken;
+
+	if(job->series_file == NULL) {
+		return write_archive_file(job);
+	}
+
+	while(*broken != NULL
+	      && safe_str_neq((*broken)->series_file, job->series_file)) {
+		broken = &((*broken)->next);
+	}
+
+	if(*broken != NULL && job->base != NULL) {
+		/* don't leave an older input of the same name behind */
+		unlink(job->filename);
+		job->skipped = TRUE;
+		job->failed = "save";
+		return FALSE;
+	}
+
+	if(write_archive_file(job) == FALSE) {
+		if(*broken == NULL) {
+			crm_malloc0(*broken, sizeof(archive_broken_t));
+			(*broken)->series_file = crm_strdup(job->series_file);
+		}
+		return FALSE;
+	}
+
+	if(*broken != NULL && job->base == NULL) {
+		/* saved in full, later deltas can be read again */
+		archive_broken_t *repaired = *broken;
+		*broken = repaired->next;
+		crm_free(repaired->series_file);
+		crm_free(repaired);
+	}
+	return TRUE;
+}
+
+static void
+report_archive_job(archive_job_t *job)
+{
+	if(job->skipped) {
+		crm_err("Could not save %s: it depends on %s, which was not saved",
+			job->filename, job->base);
+
+	} else if(job->failed != NULL) {
+		crm_err("Could not %s %s: %s",
+			job->failed, job->filename, strerror(job->rc));
+	} else {
+		crm_debug_2("Saved %s", job->filename);
+	}
+}
+
+#if ARCHIVE_THREADS
+static pthread_t archive_thread;
+static gboolean archive_running = FALSE;
+static pthread_mutex_t archive_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t archive_cond = PTHREAD_COND_INITIALIZER;
+
+static archive_job_t *archive_queue[PE_ARCHIVE_QUEUE_MAX];
+static int archive_head = 0;		/* oldest queued job */
+static int archive_waiting = 0;		/* queued but not started */
+static int archive_queued = 0;		/* including the one being written */
+
+static void *
+archive_worker(void *user_data)
+{
+	archive_job_t *job = NULL;
+
+	pthread_mutex_lock(&archive_lock);
+	while(TRUE) {
+		while(archive_waiting == 0) {
+			pthread_cond_wait(&archive_cond, &archive_lock);
+		}
+		job = archive_queue[archive_head];
+		archive_queue[archive_head] = NULL;
+		archive_head = (archive_head + 1) % PE_ARCHIVE_QUEUE_MAX;
+		archive_waiting--;
+		pthread_mutex_unlock(&archive_lock);
+
+		save_archive_job(job);
+
+		pthread_mutex_lock(&archive_lock);
+		if(job->failed != NULL) {
+			job->next = archive_failed;
+			archive_failed = job;
+		} else {
+			free_archive_job(job);
+		}
+		archive_queued--;
+		pthread_cond_broadcast(&archive_cond);
+	}
+	return NULL;
+}
+
+static gboolean
+queue_archive_job(archive_job_t *job)
+{
+	if(archive_running == FALSE) {
+		if(pthread_create(&archive_thread, NULL, archive_worker, NULL) != 0) {
+			crm_perror(LOG_WARNING, "Could not start the PE input writer");
+			return FALSE;
+		}
+		pthread_detach(archive_thread);
+		archive_running = TRUE;
+	}
+
+	pthread_mutex_lock(&archive_lock);
+	while(archive_queued >= PE_ARCHIVE_QUEUE_MAX) {
+		crm_debug("Waiting for the PE input writer to catch up");
+		pthread_cond_wait(&archive_cond, &archive_lock);
+	}
+	archive_queue[(archive_head + archive_waiting) % PE_ARCHIVE_QUEUE_MAX] = job;
+	archive_waiting++;
+	archive_queued++;
+	pthread_cond_broadcast(&archive_cond);
+	pthread_mutex_unlock(&archive_lock);
+	return TRUE;
+}
+
+static void
+wait_for_archive_queue(void)
+{
+	pthread_mutex_lock(&archive_lock);
+	while(archive_queued > 0) {
+		pthread_cond_wait(&archive_cond, &archive_lock);
+	}
+	pthread_mutex_unlock(&archive_lock);
+}
+#endif
+
+/* Log (and forget) anything the writer couldn't save */
+static void
+report_archive_failures(void)
+{
+	archive_job_t *failed = NULL;
+	archive_job_t *oldest = NULL;
+
+#if ARCHIVE_THREADS
+	pthread_mutex_lock(&archive_lock);
+#endif
+	failed = archive_failed;
+	archive_failed = NULL;
+#if ARCHIVE_THREADS
+	pthread_mutex_unlock(&archive_lock);
+#endif
+
+	if(failed != NULL && archive_series != NULL) {
+		/* the next input in each series must be saved in full */
+		g_hash_table_destroy(archive_series);
+		archive_series = NULL;
+	}
+
+	/* report them in the order they were saved */
+	while(failed != NULL) {
+		archive_job_t *job = failed;
+		failed = job->next;
+		job->next = oldest;
+		oldest = job;
+	}
+	while(oldest != NULL) {
+		archive_job_t *job = oldest;
+		oldest = job->next;
+		report_archive_job(job);
+		free_archive_job(job);
+	}
+}
+
+/* Format 'input' as the changes since the previous one in 'series',
+ * or return NULL if it should be saved in full.  The delta's base is
+ * returned in 'base'.
+ */
+static char *
+delta_archive_input(xmlNode *input, const char *filename, const char *series,
+		    int sequence, int keyframes, char **base)
+{
+	char *digest = NULL;
+	char *buffer = NULL;
+	xmlNode *diff = NULL;
+	xmlNode *delta = NULL;
+	xmlNode *check = NULL;
+	const char *basename = strrchr(filename, '/');
+	archive_series_t *a_series = NULL;
+
+	basename = basename?basename+1:filename;
+
+	if(archive_series == NULL) {
+		archive_series = g_hash_table_new_full(
+			g_str_hash, g_str_equal,
+			g_hash_destroy_str, free_archive_series);
+	}
+
+	a_series = g_hash_table_lookup(archive_series, series);
+	if(a_series == NULL) {
+		crm_malloc0(a_series, sizeof(archive_series_t));
+		g_hash_table_insert(archive_series, crm_strdup(series), a_series);
+
+	} else if(a_series->last_input != NULL
+		  /* the first input after wrapping is always saved in full */
+		  && sequence > 1
+		  && a_series->deltas + 1 < keyframes
+		  && safe_str_neq(a_series->last_file, basename)) {
+
+		diff = diff_xml_object(a_series->last_input, input, FALSE);
+		if(diff == NULL) {
+			diff = create_xml_node(NULL, "diff");
+		}
+
+		digest = calculate_xml_digest(input, FALSE, TRUE);
+		crm_xml_add(diff, XML_ATTR_DIGEST, digest);
+
+		/* Not every change (eg. re-ordering) can be expressed */
+		if(apply_xml_diff(a_series->last_input, diff, &check)) {
+			delta = create_xml_node(NULL, XML_TAG_PE_DELTA);
+			crm_xml_add(delta, XML_PE_DELTA_BASE, a_series->last_file);
+			add_node_copy(delta, diff);
+			buffer = dump_xml_formatted(delta);
+			*base = crm_strdup(a_series->last_file);
+
+		} else {
+			crm_debug("Saving %s in full: the delta did not apply",
+				  basename);
+		}
+	}
+
+	free_xml(a_series->last_input);
+	crm_free(a_series->last_file);
+
+	a_series->last_input = copy_xml(input);
+	a_series->last_file = crm_strdup(basename);
+	a_series->deltas = buffer?a_series->deltas+1:0;
+
+	crm_free(digest);
+	free_xml(check);
+	free_xml(delta);
+	free_xml(diff);
+	return buffer;
+}
+
+/* Save 'input' to 'filename' and then record 'sequence' as the next one
+ * to use for 'series' (unless series is NULL)
+ *
+ * level is the bzip2 block size, zero writes the input uncompressed.
+ * If keyframes is greater than one, only every keyframes'th input in
+ * the series is saved in full.
+ */
+void
+pe_archive_input(xmlNode *input, const char *filename, const char *series,
+		 int sequence, int level, int keyframes, gboolean async)
+{
+	time_t now;
+	char *now_str = NULL;
+	archive_job_t *job = NULL;
+
+	CRM_CHECK(input != NULL, return);
+	CRM_CHECK(filename != NULL, return);
+
+	report_archive_failures();
+
+	/* as write_xml_file() would have */
+	now = time(NULL);
+	now_str = ctime(&now);
+	now_str[24] = EOS; /* replace the newline */
+	crm_xml_add(input, XML_CIB_ATTR_WRITTEN, now_str);
+
+	crm_malloc0(job, sizeof(archive_job_t));
+	job->filename = crm_strdup(filename);
+	if(series != NULL && keyframes > 1) {
+		job->buffer = delta_archive_input(
+			input, filename, series, sequence, keyframes, &job->base);
+
+	} else if(archive_series != NULL) {
+		g_hash_table_destroy(archive_series);
+		archive_series = NULL;
+	}
+	if(job->buffer == NULL) {
+		job->buffer = dump_xml_formatted(input);
+	}
+	job->level = level;
+	job->sequence = sequence;
+	if(series != NULL) {
+		/* next to the input, ie. in PE_STATE_DIR for the pengine */
+		const char *dir_end = strrchr(filename, '/');
+		int dir_len = dir_end?(dir_end - filename + 1):0;
+
+		crm_malloc0(job->series_file, dir_len + strlen(series) + 6);
+		sprintf(job->series_file, "%.*s%s.last", dir_len, filename, series);
+	}
+
+	CRM_CHECK(job->buffer != NULL && strlen(job->buffer) > 0,
+		  free_archive_job(job);
+		  return);
+
+#if ARCHIVE_THREADS
+	if(async && queue_archive_job(job)) {
+		return;
+	}
+	/* not ahead of anything still queued */
+	wait_for_archive_queue();
+#endif
+
+	if(save_archive_job(job) == FALSE && archive_series != NULL) {
+		/* the next input in each series must be saved in full */
+		g_hash_table_destroy(archive_series);
+		archive_series = NULL;
+	}
+	report_archive_job(job);
+	free_archive_job(job);
+}
+
+/* Wait for everything queued so far to be written */
+void
+pe_archive_flush(void)
+{
+#if ARCHIVE_THREADS
+	wait_for_archive_queue();
+#endif
+	report_archive_failures();
+}
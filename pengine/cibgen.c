@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2004 Andrew Beekhof <andrew@beekhof.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <crm_internal.h>
+#include <crm/crm.h>
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <crm/common/xml.h>
+#include <crm/common/util.h>
+#include <crm/msg_xml.h>
+
+#include <glib.h>
+#include <pengine.h>
+#include <allocate.h>
+
+/* Generate a CIB of a given size for benchmarking the PE
+ *
+ * The configuration is made up deterministically from the options
+ * (and the seed).  The status section is then filled in by running the
+ * PE on it and recording each resource action in its graph as having
+ * succeeded, the way the crmd would have, until the cluster is stable.
+ */
+
+extern xmlNode * do_calculations(
+	pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now);
+
+#define CIBGEN_TE_UUID "cibgen-0000-0000-0000-000000000000"
+#define CIBGEN_MAX_PASSES 5
+#define CIBGEN_RACKS 4
+
+static int num_nodes = 16;
+static int num_primitives = 32;
+static int num_groups = 0;
+static int group_size = 3;
+static int num_clones = 0;
+static int num_masters = 0;
+static int num_constraints = 0;
+static int num_rules = 0;
+static int history = 1;
+static gboolean with_history = TRUE;
+
+static guint32 gen_seed = 1;
+static int call_id = 0;
+static int expr_id = 0;
+
+/* Not random(), so that the same seed makes the same CIB everywhere.
+ * The state is 32 bits wide on every platform, so it wraps the same way.
+ */
+static int
+gen_random(int max)
+{
+	gen_seed = gen_seed * 1103515245 + 12345;
+	if(max <= 0) {
+		return 0;
+	}
+	return (int)((gen_seed / 65536) % 32768) % max;
+}
+
+static xmlNode *
+add_nvpair(xmlNode *parent, const char *id, const char *name, const char *value)
+{
+	xmlNode *nvpair = create_xml_node(parent, XML_CIB_TAG_NVPAIR);
+	crm_xml_add(nvpair, XML_ATTR_ID, id);
+	crm_xml_add(nvpair, XML_NVPAIR_ATTR_NAME, name);
+	crm_xml_add(nvpair, XML_NVPAIR_ATTR_VALUE, value);
+	return nvpair;
+}
+
+static xmlNode *
+add_primitive(xmlNode *parent, const char *id, const char *type, gboolean stateful)
+{
+	int lpc = 0;
+	char buffer[256];
+	xmlNode *ops = NULL;
+	xmlNode *op = NULL;
+	xmlNode *primitive = create_xml_node(parent, XML_CIB_TAG_RESOURCE);
+
+	crm_xml_add(primitive, XML_ATTR_ID, id);
+	crm_xml_add(primitive, XML_AGENT_ATTR_CLASS, "ocf");
+	crm_xml_add(primitive, XML_AGENT_ATTR_PROVIDER, "pacemaker");
+	crm_xml_add(primitive, XML_ATTR_TYPE, type);
+
+	/* one recurring monitor, and so one history entry, per unit of history */
+	ops = create_xml_node(primitive, "operations");
+	for(lpc = 0; lpc < history; lpc++) {
+		int interval = 10 * (lpc + 1);
+
+		op = create_xml_node(ops, "op");
+		snprintf(buffer, sizeof(buffer), "%s-monitor-%ds", id, interval);
+		crm_xml_add(op, XML_ATTR_ID, buffer);
+		crm_xml_add(op, XML_NVPAIR_ATTR_NAME, RSC_STATUS);
+		snprintf(buffer, sizeof(buffer), "%ds", interval);
+		crm_xml_add(op, XML_LRM_ATTR_INTERVAL, buffer);
+
+		if(stateful) {
+			/* Master and Slave monitors can't share an interval */
+			crm_xml_add(op, XML_RULE_ATTR_ROLE, RSC_ROLE_SLAVE_S);
+
+			op = create_xml_node(ops, "op");
+			snprintf(buffer, sizeof(buffer), "%s-monitor-%ds", id, interval+1);
+			crm_xml_add(op, XML_ATTR_ID, buffer);
+			crm_xml_add(op, XML_NVPAIR_ATTR_NAME, RSC_STATUS);
+			snprintf(buffer, sizeof(buffer), "%ds", interval+1);
+			crm_xml_add(op, XML_LRM_ATTR_INTERVAL, buffer);
+			crm_xml_add(op, XML_RULE_ATTR_ROLE, RSC_ROLE_MASTER_S);
+		}
+	}
+	return primitive;
+}
+
+static xmlNode *
+add_location_rule(xmlNode *constraints, const char *id, const char *rsc,
+		  const char *role, int score)
+{
+	char buffer[256];
+	xmlNode *rule = NULL;
+	xmlNode *location = create_xml_node(constraints, XML_CONS_TAG_RSC_LOCATION);
+
+	crm_xml_add(location, XML_ATTR_ID, id);
+	crm_xml_add(location, XML_COLOC_ATTR_SOURCE, rsc);
+
+	rule = create_xml_node(location, XML_TAG_RULE);
+	snprintf(buffer, sizeof(buffer), "%s-rule", id);
+	crm_xml_add(rule, XML_ATTR_ID, buffer);
+	crm_xml_add_int(rule, XML_RULE_ATTR_SCORE, score);
+	crm_xml_add(rule, XML_RULE_ATTR_ROLE, role);
+	return rule;
+}
+
+static xmlNode *
+add_expression(xmlNode *rule, const char *attr, const char *op, const char *value)
+{
+	char buffer[256];
+	xmlNode *expr = create_xml_node(rule, XML_TAG_EXPRESSION);
+
+	snprintf(buffer, sizeof(buffer), "%s-expr-%d", ID(rule), ++expr_id);
+	crm_xml_add(expr, XML_ATTR_ID, buffer);
+	crm_xml_add(expr, XML_EXPR_ATTR_ATTRIBUTE, attr);
+	crm_xml_add(expr, XML_EXPR_ATTR_OPERATION, op);
+	crm_xml_add(expr, XML_EXPR_ATTR_VALUE, value);
+	return expr;
+}
+
+static xmlNode *
+generate_cib(void)
+{
+	int lpc = 0;
+	int lpc2 = 0;
+	int num_top = 0;
+	char **top = NULL;
+	char buffer[256];
+	char value[64];
+	xmlNode *cib = create_xml_node(NULL, XML_TAG_CIB);
+	xmlNode *config = create_xml_node(cib, XML_CIB_TAG_CONFIGURATION);
+	xmlNode *crm_config = create_xml_node(config, XML_CIB_TAG_CRMCONFIG);
+	xmlNode *nodes = create_xml_node(config, XML_CIB_TAG_NODES);
+	xmlNode *resources = create_xml_node(config, XML_CIB_TAG_RESOURCES);
+	xmlNode *constraints = create_xml_node(config, XML_CIB_TAG_CONSTRAINTS);
+	xmlNode *status = create_xml_node(cib, XML_CIB_TAG_STATUS);
+	xmlNode *props = NULL;
+	xmlNode *rule = NULL;
+	xmlNode *xml_obj = NULL;
+
+	crm_xml_add(cib, XML_ATTR_GENERATION_ADMIN, "0");
+	crm_xml_add(cib, XML_ATTR_GENERATION, "1");
+	crm_xml_add(cib, XML_ATTR_NUMUPDATES, "0");
+	crm_xml_add(cib, XML_ATTR_HAVE_QUORUM, XML_BOOLEAN_TRUE);
+	crm_xml_add(cib, XML_ATTR_DC_UUID, "node-1");
+	crm_xml_add(cib, XML_ATTR_CRM_VERSION, CRM_FEATURE_SET);
+	crm_xml_add(cib, XML_ATTR_VALIDATION, "pacemaker-1.0");
+
+	props = create_xml_node(crm_config, XML_CIB_TAG_PROPSET);
+	crm_xml_add(props, XML_ATTR_ID, "cib-bootstrap-options");
+	add_nvpair(props, "opt-stonith-enabled", "stonith-enabled", XML_BOOLEAN_FALSE);
+
+	for(lpc = 1; lpc <= num_nodes; lpc++) {
+		xmlNode *node_state = NULL;
+		xmlNode *lrm = NULL;
+
+		snprintf(buffer, sizeof(buffer), "node-%d", lpc);
+		xml_obj = create_xml_node(nodes, XML_CIB_TAG_NODE);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		crm_xml_add(xml_obj, XML_ATTR_UNAME, buffer);
+		crm_xml_add(xml_obj, XML_ATTR_TYPE, "normal");
+
+		/* something for the rules to look at */
+		props = create_xml_node(xml_obj, XML_TAG_ATTR_SETS);
+		snprintf(buffer, sizeof(buffer), "node-%d-attrs", lpc);
+		crm_xml_add(props, XML_ATTR_ID, buffer);
+		snprintf(buffer, sizeof(buffer), "node-%d-rack", lpc);
+		snprintf(value, sizeof(value), "%d", lpc % CIBGEN_RACKS);
+		add_nvpair(props, buffer, "rack", value);
+
+		snprintf(buffer, sizeof(buffer), "node-%d", lpc);
+		node_state = create_xml_node(status, XML_CIB_TAG_STATE);
+		crm_xml_add(node_state, XML_ATTR_ID, buffer);
+		crm_xml_add(node_state, XML_ATTR_UNAME, buffer);
+		crm_xml_add(node_state, XML_CIB_ATTR_HASTATE, ACTIVESTATUS);
+		crm_xml_add(node_state, XML_CIB_ATTR_INCCM, XML_BOOLEAN_YES);
+		crm_xml_add(node_state, XML_CIB_ATTR_CRMDSTATE, ONLINESTATUS);
+		crm_xml_add(node_state, XML_CIB_ATTR_JOINSTATE, CRMD_JOINSTATE_MEMBER);
+		crm_xml_add(node_state, XML_CIB_ATTR_EXPSTATE, CRMD_JOINSTATE_MEMBER);
+		crm_xml_add(node_state, XML_ATTR_ORIGIN, "cibgen");
+
+		lrm = create_xml_node(node_state, XML_CIB_TAG_LRM);
+		crm_xml_add(lrm, XML_ATTR_ID, buffer);
+		create_xml_node(lrm, XML_LRM_TAG_RESOURCES);
+	}
+
+	crm_malloc0(top, (num_primitives + num_groups + num_clones + num_masters + 1)
+		    * sizeof(char*));
+
+	for(lpc = 1; lpc <= num_primitives; lpc++) {
+		snprintf(buffer, sizeof(buffer), "rsc-%d", lpc);
+		add_primitive(resources, buffer, "Dummy", FALSE);
+		top[num_top++] = crm_strdup(buffer);
+	}
+
+	for(lpc = 1; lpc <= num_groups; lpc++) {
+		snprintf(buffer, sizeof(buffer), "grp-%d", lpc);
+		xml_obj = create_xml_node(resources, XML_CIB_TAG_GROUP);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		top[num_top++] = crm_strdup(buffer);
+
+		for(lpc2 = 1; lpc2 <= group_size; lpc2++) {
+			snprintf(buffer, sizeof(buffer), "grp-%d-rsc-%d", lpc, lpc2);
+			add_primitive(xml_obj, buffer, "Dummy", FALSE);
+		}
+	}
+
+	for(lpc = 1; lpc <= num_clones; lpc++) {
+		snprintf(buffer, sizeof(buffer), "cln-%d", lpc);
+		xml_obj = create_xml_node(resources, XML_CIB_TAG_INCARNATION);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		top[num_top++] = crm_strdup(buffer);
+
+		snprintf(buffer, sizeof(buffer), "cln-%d-rsc", lpc);
+		add_primitive(xml_obj, buffer, "Dummy", FALSE);
+	}
+
+	for(lpc = 1; lpc <= num_masters; lpc++) {
+		snprintf(buffer, sizeof(buffer), "ms-%d", lpc);
+		xml_obj = create_xml_node(resources, XML_CIB_TAG_MASTER);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		top[num_top++] = crm_strdup(buffer);
+
+		snprintf(buffer, sizeof(buffer), "ms-%d-rsc", lpc);
+		add_primitive(xml_obj, buffer, "Stateful", TRUE);
+
+		/* something has to prefer a node for the Master role */
+		snprintf(buffer, sizeof(buffer), "ms-%d-master", lpc);
+		rule = add_location_rule(
+			constraints, buffer, top[num_top-1], RSC_ROLE_MASTER_S, 100);
+		snprintf(value, sizeof(value), "node-%d", 1 + gen_random(num_nodes));
+		add_expression(rule, "#uname", "eq", value);
+	}
+
+	for(lpc = 1; num_top > 0 && lpc <= num_constraints; lpc++) {
+		/* always 'rsc' after 'with-rsc' so there are no loops */
+		int first = gen_random(num_top);
+		int then = gen_random(num_top);
+		if(then < first) {
+			int tmp = first;
+			first = then;
+			then = tmp;
+		}
+
+		snprintf(buffer, sizeof(buffer), "loc-%d", lpc);
+		xml_obj = create_xml_node(constraints, XML_CONS_TAG_RSC_LOCATION);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		crm_xml_add(xml_obj, XML_COLOC_ATTR_SOURCE, top[gen_random(num_top)]);
+		snprintf(value, sizeof(value), "node-%d", 1 + gen_random(num_nodes));
+		crm_xml_add(xml_obj, XML_CIB_TAG_NODE, value);
+		crm_xml_add_int(xml_obj, XML_RULE_ATTR_SCORE, 1 + gen_random(100));
+
+		if(first == then) {
+			continue;
+		}
+
+		snprintf(buffer, sizeof(buffer), "col-%d", lpc);
+		xml_obj = create_xml_node(constraints, XML_CONS_TAG_RSC_DEPEND);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		crm_xml_add(xml_obj, XML_COLOC_ATTR_SOURCE, top[then]);
+		crm_xml_add(xml_obj, XML_COLOC_ATTR_TARGET, top[first]);
+		crm_xml_add(xml_obj, XML_RULE_ATTR_SCORE, INFINITY_S);
+
+		snprintf(buffer, sizeof(buffer), "ord-%d", lpc);
+		xml_obj = create_xml_node(constraints, XML_CONS_TAG_RSC_ORDER);
+		crm_xml_add(xml_obj, XML_ATTR_ID, buffer);
+		crm_xml_add(xml_obj, XML_ORDER_ATTR_FIRST, top[first]);
+		crm_xml_add(xml_obj, XML_ORDER_ATTR_THEN, top[then]);
+		crm_xml_add(xml_obj, XML_RULE_ATTR_SCORE, INFINITY_S);
+	}
+
+	for(lpc = 1; num_top > 0 && lpc <= num_rules; lpc++) {
+		snprintf(buffer, sizeof(buffer), "rule-loc-%d", lpc);
+		rule = add_location_rule(constraints, buffer, top[gen_random(num_top)],
+					 NULL, 1 + gen_random(100));
+		crm_xml_add(rule, XML_RULE_ATTR_BOOLEAN_OP, "and");
+
+		snprintf(value, sizeof(value), "%d", gen_random(CIBGEN_RACKS));
+		add_expression(rule, "rack", "eq", value);
+		snprintf(value, sizeof(value), "node-%d", 1 + gen_random(num_nodes));
+		add_expression(rule, "#uname", "ne", value);
+	}
+
+	for(lpc = 0; lpc < num_top; lpc++) {
+		crm_free(top[lpc]);
+	}
+	crm_free(top);
+	return cib;
+}
+
+typedef struct gen_op_s
+{
+	int rank;
+	int order;
+	xmlNode *action;
+} gen_op_t;
+
+/* The order the crmd would have completed them in */
+static int
+gen_op_rank(xmlNode *action)
+{
+	const char *task = crm_element_value(action, XML_LRM_ATTR_TASK);
+	const char *interval = crm_element_value(
+		find_xml_node(action, XML_TAG_ATTRS, FALSE),
+		CRM_META"_"XML_LRM_ATTR_INTERVAL);
+
+	if(safe_str_eq(task, RSC_STATUS)) {
+		return crm_parse_int(interval, "0") > 0?5:0;
+
+	} else if(safe_str_eq(task, RSC_DEMOTE)) {
+		return 1;
+	} else if(safe_str_eq(task, RSC_STOP)) {
+		return 2;
+	} else if(safe_str_eq(task, RSC_START)) {
+		return 3;
+	} else if(safe_str_eq(task, RSC_PROMOTE)) {
+		return 4;
+	}
+	/* notifications, cancellations, etc aren't recorded */
+	return -1;
+}
+
+static gint
+sort_gen_op(gconstpointer a, gconstpointer b)
+{
+	const gen_op_t *op_a = a;
+	const gen_op_t *op_b = b;
+
+	if(op_a->rank != op_b->rank) {
+		return op_a->rank - op_b->rank;
+	}
+	return op_a->order - op_b->order;
+}
+
+/* Record 'action' from a transition graph as having succeeded,
+ * as build_operation_update() in the crmd would have
+ */
+static void
+record_op(GHashTable *lrm_index, xmlNode *action, int transition)
+{
+	int rc = 0;
+	int interval = 0;
+	char *op_id = NULL;
+	char *key = NULL;
+	char *magic = NULL;
+	char *digest = NULL;
+	GHashTable *params = NULL;
+	xmlNode *args_xml = NULL;
+	xmlNode *xml_rsc = NULL;
+	xmlNode *xml_op = NULL;
+	xmlNode *rsc = find_xml_node(action, XML_CIB_TAG_RESOURCE, TRUE);
+	const char *task = crm_element_value(action, XML_LRM_ATTR_TASK);
+	const char *target = crm_element_value(action, XML_LRM_ATTR_TARGET_UUID);
+	xmlNode *lrm_resources = g_hash_table_lookup(lrm_index, crm_str(target));
+
+	CRM_CHECK(rsc != NULL && lrm_resources != NULL, return);
+
+	params = xml2list(action);
+	rc = crm_parse_int(crm_meta_value(params, XML_ATTR_TE_TARGET_RC), "0");
+	interval = crm_parse_int(crm_meta_value(params, XML_LRM_ATTR_INTERVAL), "0");
+	g_hash_table_remove(params, CRM_META"_"XML_ATTR_TE_TARGET_RC);
+
+	xml_rsc = find_entity(lrm_resources, XML_LRM_TAG_RESOURCE, ID(rsc));
+	if(xml_rsc == NULL) {
+		xml_rsc = create_xml_node(lrm_resources, XML_LRM_TAG_RESOURCE);
+		crm_xml_add(xml_rsc, XML_ATTR_ID, ID(rsc));
+		crm_xml_add(xml_rsc, XML_AGENT_ATTR_CLASS,
+			    crm_element_value(rsc, XML_AGENT_ATTR_CLASS));
+		crm_xml_add(xml_rsc, XML_AGENT_ATTR_PROVIDER,
+			    crm_element_value(rsc, XML_AGENT_ATTR_PROVIDER));
+		crm_xml_add(xml_rsc, XML_ATTR_TYPE,
+			    crm_element_value(rsc, XML_ATTR_TYPE));
+	}
+
+	op_id = generate_op_key(ID(rsc), task, interval);
+	xml_op = find_entity(xml_rsc, XML_LRM_TAG_RSC_OP, op_id);
+	if(xml_op == NULL) {
+		xml_op = create_xml_node(xml_rsc, XML_LRM_TAG_RSC_OP);
+	}
+
+	key = generate_transition_key(
+		transition, crm_parse_int(ID(action), "0"), rc, CIBGEN_TE_UUID);
+	magic = generate_transition_magic(key, LRM_OP_DONE, rc);
+
+	crm_xml_add(xml_op, XML_ATTR_ID, op_id);
+	crm_xml_add(xml_op, XML_LRM_ATTR_TASK, task);
+	crm_xml_add(xml_op, XML_ATTR_ORIGIN, "cibgen");
+	crm_xml_add(xml_op, XML_ATTR_CRM_VERSION, CRM_FEATURE_SET);
+	crm_xml_add(xml_op, XML_ATTR_TRANSITION_KEY, key);
+	crm_xml_add(xml_op, XML_ATTR_TRANSITION_MAGIC, magic);
+	crm_xml_add_int(xml_op, XML_LRM_ATTR_CALLID, ++call_id);
+	crm_xml_add_int(xml_op, XML_LRM_ATTR_RC, rc);
+	crm_xml_add_int(xml_op, XML_LRM_ATTR_OPSTATUS, LRM_OP_DONE);
+	crm_xml_add_int(xml_op, XML_LRM_ATTR_INTERVAL, interval);
+
+	/* see append_digest() */
+	args_xml = create_xml_node(NULL, XML_TAG_PARAMS);
+	g_hash_table_foreach(params, hash2field, args_xml);
+	filter_action_parameters(args_xml, CRM_FEATURE_SET);
+	digest = calculate_xml_digest(args_xml, TRUE, FALSE);
+	crm_xml_add(xml_op, XML_LRM_ATTR_OP_DIGEST, digest);
+
+	free_xml(args_xml);
+	g_hash_table_destroy(params);
+	crm_free(digest);
+	crm_free(magic);
+	crm_free(key);
+	crm_free(op_id);
+}
+
+/* Run the PE and pretend its graph was executed
+ * Returns the number of resource actions it contained
+ */
+static int
+apply_transition(xmlNode *cib, int transition)
+{
+	int order = 0;
+	GListPtr ops = NULL;
+	pe_working_set_t data_set;
+	GHashTable *lrm_index = g_hash_table_new(g_str_hash, g_str_equal);
+
+	xml_child_iter_filter(
+		find_xml_node(cib, XML_CIB_TAG_STATUS, TRUE), node_state,
+		XML_CIB_TAG_STATE,
+		xmlNode *lrm = find_xml_node(node_state, XML_CIB_TAG_LRM, TRUE);
+		g_hash_table_insert(lrm_index, (gpointer)ID(node_state),
+				    find_xml_node(lrm, XML_LRM_TAG_RESOURCES, TRUE));
+		);
+
+	do_calculations(&data_set, copy_xml(cib), NULL);
+
+	xml_child_iter_filter(
+		data_set.graph, synapse, "synapse",
+		xml_child_iter_filter(
+			synapse, action_set, "action_set",
+			xml_child_iter_filter(
+				action_set, action, XML_GRAPH_TAG_RSC_OP,
+				gen_op_t *op = NULL;
+				int rank = gen_op_rank(action);
+				if(rank < 0) {
+					continue;
+				}
+				crm_malloc0(op, sizeof(gen_op_t));
+				op->rank = rank;
+				op->order = order++;
+				op->action = action;
+				ops = g_list_prepend(ops, op);
+				);
+			);
+		);
+
+	ops = g_list_sort(ops, sort_gen_op);
+	slist_iter(
+		op, gen_op_t, ops, lpc,
+		record_op(lrm_index, op->action, transition);
+		crm_free(op);
+		);
+
+	g_list_free(ops);
+	g_hash_table_destroy(lrm_index);
+	cleanup_alloc_calculations(&data_set);
+	return order;
+}
+
+static struct crm_option long_options[] = {
+    /* Top-level Options */
+    {"help",        0, 0, '?', "This text"},
+    {"version",     0, 0, '$', "Version information"  },
+    {"verbose",     0, 0, 'V', "Increase debug output\n"},
+
+    {"nodes",       1, 0, 'n', "\tNumber of nodes (default: 16)"},
+    {"primitives",  1, 0, 'p', "Number of ungrouped primitives (default: 32)"},
+    {"groups",      1, 0, 'g', "\tNumber of groups (default: 0)"},
+    {"group-size",  1, 0, 'z', "Number of primitives in each group (default: 3)"},
+    {"clones",      1, 0, 'c', "\tNumber of anonymous clones (default: 0)"},
+    {"masters",     1, 0, 'm', "\tNumber of master/slave resources (default: 0)"},
+    {"constraints", 1, 0, 'C', "Number of location, colocation and ordering constraints, each (default: 0)"},
+    {"rules",       1, 0, 'r', "\tNumber of rule based location constraints (default: 0)"},
+    {"history",     1, 0, 'H', "\tNumber of recurring monitors, and therefor operation history entries, per resource (default: 1)"},
+    {"no-history",  0, 0, 'E', "Leave the status section empty, as if the cluster had just started"},
+    {"seed",        1, 0, 's', "\tSeed for the made up placement and constraints (default: 1)\n"},
+
+    {"output",      1, 0, 'o', "\tSave the CIB to the named file instead of printing it"},
+
+    {0, 0, 0, 0}
+};
+
+int
+main(int argc, char **argv)
+{
+	int flag;
+	int argerr = 0;
+	int pass = 0;
+	int actions = 0;
+	char *buffer = NULL;
+	xmlNode *cib = NULL;
+	const char *output = NULL;
+
+	crm_log_init("cibgen", LOG_CRIT, FALSE, FALSE, 0, NULL);
+	crm_set_options("V?$n:p:g:z:c:m:C:r:H:Es:o:", "[-?V] [options]", long_options,
+			"Generate a cluster configuration, and matching status, of a given size\n");
+
+	while (1) {
+		int option_index = 0;
+		flag = crm_get_option(argc, argv, &option_index);
+		if (flag == -1)
+			break;
+
+		switch(flag) {
+			case 'n':
+				num_nodes = crm_parse_int(optarg, "16");
+				break;
+			case 'p':
+				num_primitives = crm_parse_int(optarg, "32");
+				break;
+			case 'g':
+				num_groups = crm_parse_int(optarg, "0");
+				break;
+			case 'z':
+				group_size = crm_parse_int(optarg, "3");
+				break;
+			case 'c':
+				num_clones = crm_parse_int(optarg, "0");
+				break;
+			case 'm':
+				num_masters = crm_parse_int(optarg, "0");
+				break;
+			case 'C':
+				num_constraints = crm_parse_int(optarg, "0");
+				break;
+			case 'r':
+				num_rules = crm_parse_int(optarg, "0");
+				break;
+			case 'H':
+				history = crm_parse_int(optarg, "1");
+				break;
+			case 'E':
+				with_history = FALSE;
+				break;
+			case 's':
+				gen_seed = crm_parse_int(optarg, "1");
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			case 'V':
+				cl_log_enable_stderr(TRUE);
+				alter_debug(DEBUG_INC);
+				break;
+			case '$':
+			case '?':
+				crm_help(flag, 0);
+				break;
+			default:
+				fprintf(stderr, "Option -%c is not yet supported\n", flag);
+				++argerr;
+				break;
+		}
+	}
+
+	if(optind < argc || num_nodes < 1 || num_primitives < 0 || num_groups < 0
+	   || group_size < 1 || num_clones < 0 || num_masters < 0
+	   || num_constraints < 0 || num_rules < 0 || history < 0) {
+		++argerr;
+	}
+
+	if (argerr) {
+		crm_err("%d errors in option parsing", argerr);
+		crm_help('?', 1);
+	}
+
+	cib = generate_cib();
+
+	for(pass = 1; with_history && pass <= CIBGEN_MAX_PASSES; pass++) {
+		actions = apply_transition(cib, pass);
+		crm_info("Transition %d: %d resource actions", pass, actions);
+		if(actions == 0) {
+			break;
+		}
+	}
+	if(with_history && actions > 0) {
+		fprintf(stderr, "The cluster was still not stable after %d transitions\n",
+			CIBGEN_MAX_PASSES);
+	}
+
+	if(validate_xml(cib, NULL, FALSE) != TRUE) {
+		fprintf(stderr, "The generated CIB does not validate\n");
+		free_xml(cib);
+		return 1;
+	}
+
+	if(output != NULL) {
+		if(write_xml_file(cib, output, FALSE) < 0) {
+			fprintf(stderr, "Could not write %s\n", output);
+			free_xml(cib);
+			return 1;
+		}
+
+	} else {
+		buffer = dump_xml_formatted(cib);
+		fprintf(stdout, "%s\n", buffer);
+		crm_free(buffer);
+	}
+
+	free_xml(cib);
+	crm_log_deinit();
+	return 0;
+}
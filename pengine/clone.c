@@ -26,7 +26,7 @@
 #define VARIANT_CLONE 1
 #include <lib/pengine/variant.h>
 
-gint sort_clone_instance(gconstpointer a, gconstpointer b);
+GListPtr sort_clone_instances(GListPtr children);
 
 void child_stopping_constraints(
 	clone_variant_data_t *clone_data, 
@@ -65,21 +65,152 @@ static gboolean did_fail(const resource_t *rsc)
 }
 
 
-gint sort_clone_instance(gconstpointer a, gconstpointer b)
+/* Everything sort_clone_instance() needs to know about an instance
+ *
+ * Comparing two instances used to copy, merge and sort their node
+ * lists on every call.  None of that changes while the children are
+ * being sorted, so it is now worked out once per instance.
+ */
+struct clone_sort_key_s 
+{
+	resource_t *rsc;
+
+	int running;		/* length of rsc->running_on */
+	node_t *current;	/* NULL if not active or no longer allowed */
+	gboolean available;	/* current location is still allowed */
+	gboolean can_run;	/* can_run_resources(current) */
+	node_t *parent_node;	/* the parent's entry for current */
+	int current_weight;	/* current location's score */
+	gboolean failed;
+
+	int *weights;		/* all allowed node scores, best first */
+	int n_weights;
+	int *colocated;		/* current location after colocation */
+	int n_colocated;
+};
+
+static int *
+sorted_node_weights(GListPtr list, int *length)
+{
+	int *weights = NULL;
+
+	*length = g_list_length(list);
+	crm_malloc0(weights, (*length + 1) * sizeof(int));
+	slist_iter(
+		node, node_t, list, lpc,
+		weights[lpc] = node->weight;
+		);
+	return weights;
+}
+
+clone_sort_key_t *
+new_clone_sort_key(resource_t *rsc)
 {
 	int level = LOG_DEBUG_3;
-	node_t *node1 = NULL;
-	node_t *node2 = NULL;
+	node_t *match = NULL;
+	GListPtr list = NULL;
+	clone_sort_key_t *key = NULL;
 
-	gboolean can1 = TRUE;
-	gboolean can2 = TRUE;
-	gboolean with_scores = TRUE;
-	
-	const resource_t *resource1 = (const resource_t*)a;
-	const resource_t *resource2 = (const resource_t*)b;
+	crm_malloc0(key, sizeof(clone_sort_key_t));
+	key->rsc = rsc;
+	key->available = TRUE;
+	key->running = g_list_length(rsc->running_on);
+	key->failed = did_fail(rsc);
 
-	CRM_ASSERT(resource1 != NULL);
-	CRM_ASSERT(resource2 != NULL);
+	if(rsc->running_on) {
+		key->current = rsc->running_on->data;
+		match = pe_find_node_id(
+			rsc->allowed_nodes, key->current->details->id);
+		if(match == NULL || match->weight < 0) {
+			do_crm_log_unlikely(level, "%s: current location is unavailable", rsc->id);
+			key->current = NULL;
+			key->available = FALSE;
+		} else {
+			key->current_weight = match->weight;
+		}
+	}
+
+	key->can_run = can_run_resources(key->current);
+	key->parent_node = parent_node_instance(rsc, key->current);
+	if(key->parent_node == NULL) {
+		/* nothing past the "not allowed" test is ever consulted */
+		return key;
+	}
+
+	list = node_list_dup(rsc->allowed_nodes, FALSE, FALSE);
+	list = g_list_sort(list, sort_node_weight);
+	key->weights = sorted_node_weights(list, &key->n_weights);
+	pe_free_shallow(list);
+
+	list = g_list_append(NULL, node_copy(rsc->running_on->data));
+	slist_iter(
+		constraint, rsc_colocation_t, rsc->parent->rsc_cons_lhs, lpc,
+		do_crm_log_unlikely(level+1, "Applying %s to %s", constraint->id, rsc->id);
+		
+		list = rsc_merge_weights(
+			constraint->rsc_lh, rsc->id, list,
+			constraint->node_attribute,
+			constraint->score/INFINITY, FALSE, TRUE);
+		);
+	list = g_list_sort(list, sort_node_weight);
+	key->colocated = sorted_node_weights(list, &key->n_colocated);
+	pe_free_shallow(list);
+
+	return key;
+}
+
+void
+free_clone_sort_key(clone_sort_key_t *key)
+{
+	if(key != NULL) {
+		crm_free(key->weights);
+		crm_free(key->colocated);
+		crm_free(key);
+	}
+}
+
+static gint
+compare_node_weights(const clone_sort_key_t *key1, const int *weights1, int n1,
+		     const clone_sort_key_t *key2, const int *weights2, int n2,
+		     const char *desc)
+{
+	int lpc = 0;
+	int level = LOG_DEBUG_3;
+	int max = n1 > n2 ? n1 : n2;
+
+	for(;lpc < max; lpc++) {
+		if(lpc >= n1) {
+			do_crm_log_unlikely(level, "%s < %s: %s NULL",
+					    key1->rsc->id, key2->rsc->id, desc);
+			return 1;
+		} else if(lpc >= n2) {
+			do_crm_log_unlikely(level, "%s > %s: %s NULL",
+					    key1->rsc->id, key2->rsc->id, desc);
+			return -1;
+		}
+		
+		if(weights1[lpc] < weights2[lpc]) {
+			do_crm_log_unlikely(level, "%s < %s: %s",
+					    key1->rsc->id, key2->rsc->id, desc);
+			return 1;
+			
+		} else if(weights1[lpc] > weights2[lpc]) {
+			do_crm_log_unlikely(level, "%s > %s: %s",
+					    key1->rsc->id, key2->rsc->id, desc);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+gint sort_clone_key(gconstpointer a, gconstpointer b)
+{
+	gint rc = 0;
+	int level = LOG_DEBUG_3;
+	const clone_sort_key_t *key1 = (const clone_sort_key_t*)a;
+	const clone_sort_key_t *key2 = (const clone_sort_key_t*)b;
+	const resource_t *resource1 = key1->rsc;
+	const resource_t *resource2 = key2->rsc;
 
 	/* allocation order:
 	 *  - active instances
@@ -89,44 +220,19 @@ gint sort_clone_instance(gconstpointer a, gconstpointer b)
 	 *  - inactive instances
 	 */	
 
-	if(resource1->running_on && resource2->running_on) {
-		if(g_list_length(resource1->running_on) < g_list_length(resource2->running_on)) {
+	if(key1->running && key2->running) {
+		if(key1->running < key2->running) {
 			do_crm_log_unlikely(level, "%s < %s: running_on", resource1->id, resource2->id);
 			return -1;
 			
-		} else if(g_list_length(resource1->running_on) > g_list_length(resource2->running_on)) {
+		} else if(key1->running > key2->running) {
 			do_crm_log_unlikely(level, "%s > %s: running_on", resource1->id, resource2->id);
 			return 1;
 		}
 	}
 	
-	if(resource1->running_on) {
-		node1 = resource1->running_on->data;
-	}
-	if(resource2->running_on) {
-		node2 = resource2->running_on->data;
-	}
-
-	if(node1) {
-	    node_t *match = pe_find_node_id(resource1->allowed_nodes, node1->details->id);
-	    if(match == NULL || match->weight < 0) {
-		do_crm_log_unlikely(level, "%s: current location is unavailable", resource1->id);
-		node1 = NULL;
-		can1 = FALSE;
-	    }
-	}
-
-	if(node2) {
-	    node_t *match = pe_find_node_id(resource2->allowed_nodes, node2->details->id);
-	    if(match == NULL || match->weight < 0) {
-		do_crm_log_unlikely(level, "%s: current location is unavailable", resource2->id);
-		node2 = NULL;
-		can2 = FALSE;
-	    }
-	}
-
-	if(can1 != can2) {
-		if(can1) {
+	if(key1->available != key2->available) {
+		if(key1->available) {
 			do_crm_log_unlikely(level, "%s < %s: availability of current location", resource1->id, resource2->id);
 			return -1;
 		}
@@ -143,26 +249,24 @@ gint sort_clone_instance(gconstpointer a, gconstpointer b)
 		return -1;
 	}
 	
-	if(node1 == NULL && node2 == NULL) {
+	if(key1->current == NULL && key2->current == NULL) {
 			do_crm_log_unlikely(level, "%s == %s: not active",
 					   resource1->id, resource2->id);
 			return 0;
 	}
 
-	if(node1 != node2) {
-		if(node1 == NULL) {
+	if(key1->current != key2->current) {
+		if(key1->current == NULL) {
 			do_crm_log_unlikely(level, "%s > %s: active", resource1->id, resource2->id);
 			return 1;
-		} else if(node2 == NULL) {
+		} else if(key2->current == NULL) {
 			do_crm_log_unlikely(level, "%s < %s: active", resource1->id, resource2->id);
 			return -1;
 		}
 	}
 	
-	can1 = can_run_resources(node1);
-	can2 = can_run_resources(node2);
-	if(can1 != can2) {
-		if(can1) {
+	if(key1->can_run != key2->can_run) {
+		if(key1->can_run) {
 			do_crm_log_unlikely(level, "%s < %s: can", resource1->id, resource2->id);
 			return -1;
 		}
@@ -170,92 +274,46 @@ gint sort_clone_instance(gconstpointer a, gconstpointer b)
 		return 1;
 	}
 
-	node1 = parent_node_instance(resource1, node1);
-	node2 = parent_node_instance(resource2, node2);
-	if(node1 != NULL && node2 == NULL) {
+	if(key1->parent_node != NULL && key2->parent_node == NULL) {
 		do_crm_log_unlikely(level, "%s < %s: not allowed", resource1->id, resource2->id);
 		return -1;
-	} else if(node1 == NULL && node2 != NULL) {
+	} else if(key1->parent_node == NULL && key2->parent_node != NULL) {
 		do_crm_log_unlikely(level, "%s > %s: not allowed", resource1->id, resource2->id);
 		return 1;
 	}
 	
-	if(node1 == NULL) {
+	if(key1->parent_node == NULL) {
 		do_crm_log_unlikely(level, "%s == %s: not allowed", resource1->id, resource2->id);
 		return 0;
 	}
 
-	if(node1->count < node2->count) {
+	if(key1->parent_node->count < key2->parent_node->count) {
 		do_crm_log_unlikely(level, "%s < %s: count", resource1->id, resource2->id);
 		return -1;
 
-	} else if(node1->count > node2->count) {
+	} else if(key1->parent_node->count > key2->parent_node->count) {
 		do_crm_log_unlikely(level, "%s > %s: count", resource1->id, resource2->id);
 		return 1;
 	}
 
-	if(with_scores) {
-	    int max = 0;
-	    int lpc = 0;
-	    GListPtr list1 = node_list_dup(resource1->allowed_nodes, FALSE, FALSE);
-	    GListPtr list2 = node_list_dup(resource2->allowed_nodes, FALSE, FALSE);
-
-	    /* Current score */
-	    node1 = g_list_nth_data(resource1->running_on, 0);
-	    node1 = pe_find_node_id(list1, node1->details->id);
-
-	    node2 = g_list_nth_data(resource2->running_on, 0);
-	    node2 = pe_find_node_id(list2, node2->details->id);
-
-	    if(node1->weight < node2->weight) {
+	if(key1->current_weight < key2->current_weight) {
 		do_crm_log_unlikely(level, "%s < %s: current score", resource1->id, resource2->id);
 		return 1;
 
-	    } else if(node1->weight > node2->weight) {
+	} else if(key1->current_weight > key2->current_weight) {
 		do_crm_log_unlikely(level, "%s > %s: current score", resource1->id, resource2->id);
 		return -1;
-	    }
-
-	    /* All scores */
-	    list1 = g_list_sort(list1, sort_node_weight);
-	    list2 = g_list_sort(list2, sort_node_weight);
-	    max = g_list_length(list1);
-	    if(max < g_list_length(list2)) {
-		max = g_list_length(list2);
-	    }
-	    
-	    for(;lpc < max; lpc++) {
-		node1 = g_list_nth_data(list1, lpc);
-		node2 = g_list_nth_data(list2, lpc);
-		if(node1 == NULL) {
-		    do_crm_log_unlikely(level, "%s < %s: node score NULL", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return 1;
-		} else if(node2 == NULL) {
-		    do_crm_log_unlikely(level, "%s > %s: node score NULL", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return -1;
-		}
-		
-		if(node1->weight < node2->weight) {
-		    do_crm_log_unlikely(level, "%s < %s: node score", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return 1;
-		    
-		} else if(node1->weight > node2->weight) {
-		    do_crm_log_unlikely(level, "%s > %s: node score", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return -1;
-		}
-	    }
+	}
 
-	    pe_free_shallow(list1); pe_free_shallow(list2);
+	rc = compare_node_weights(key1, key1->weights, key1->n_weights,
+				  key2, key2->weights, key2->n_weights,
+				  "node score");
+	if(rc != 0) {
+		return rc;
 	}
 
-	can1 = did_fail(resource1);
-	can2 = did_fail(resource2);
-	if(can1 != can2) {
-	    if(can1) {
+	if(key1->failed != key2->failed) {
+	    if(key1->failed) {
 		do_crm_log_unlikely(level, "%s > %s: failed", resource1->id, resource2->id);
 		return 1;
 	    }
@@ -263,76 +321,44 @@ gint sort_clone_instance(gconstpointer a, gconstpointer b)
 	    return -1;
 	}
 
-	if(node1 && node2) {
-	    int max = 0;
-	    int lpc = 0;
-	    GListPtr list1 = g_list_append(NULL, node_copy(resource1->running_on->data));
-	    GListPtr list2 = g_list_append(NULL, node_copy(resource2->running_on->data));
-
-	    /* Possibly a replacement for the with_scores block above */
-	    
-	    slist_iter(
-		constraint, rsc_colocation_t, resource1->parent->rsc_cons_lhs, lpc,
-		do_crm_log_unlikely(level+1, "Applying %s to %s", constraint->id, resource1->id);
-		
-		list1 = rsc_merge_weights(
-		    constraint->rsc_lh, resource1->id, list1,
-		    constraint->node_attribute,
-		    constraint->score/INFINITY, FALSE, TRUE);
-		);    
-
-	    slist_iter(
-		constraint, rsc_colocation_t, resource2->parent->rsc_cons_lhs, lpc,
-		do_crm_log_unlikely(level+1, "Applying %s to %s", constraint->id, resource2->id);
-		
-		list2 = rsc_merge_weights(
-		    constraint->rsc_lh, resource2->id, list2,
-		    constraint->node_attribute,
-		    constraint->score/INFINITY, FALSE, TRUE);
-		);    
-
-	    list1 = g_list_sort(list1, sort_node_weight);
-	    list2 = g_list_sort(list2, sort_node_weight);
-	    max = g_list_length(list1);
-	    if(max < g_list_length(list2)) {
-		max = g_list_length(list2);
-	    }
-	    
-	    for(;lpc < max; lpc++) {
-		node1 = g_list_nth_data(list1, lpc);
-		node2 = g_list_nth_data(list2, lpc);
-		if(node1 == NULL) {
-		    do_crm_log_unlikely(level, "%s < %s: colocated score NULL", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return 1;
-		} else if(node2 == NULL) {
-		    do_crm_log_unlikely(level, "%s > %s: colocated score NULL", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return -1;
-		}
-		
-		if(node1->weight < node2->weight) {
-		    do_crm_log_unlikely(level, "%s < %s: colocated score", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return 1;
-		    
-		} else if(node1->weight > node2->weight) {
-		    do_crm_log_unlikely(level, "%s > %s: colocated score", resource1->id, resource2->id);
-		    pe_free_shallow(list1); pe_free_shallow(list2);
-		    return -1;
-		}
-	    }
-
-	    pe_free_shallow(list1); pe_free_shallow(list2);
+	rc = compare_node_weights(key1, key1->colocated, key1->n_colocated,
+				  key2, key2->colocated, key2->n_colocated,
+				  "colocated score");
+	if(rc != 0) {
+		return rc;
 	}
 	
-	
-	do_crm_log_unlikely(level, "%s == %s: default %d", resource1->id, resource2->id, node2->weight);
+	do_crm_log_unlikely(level, "%s == %s: default", resource1->id, resource2->id);
 	return 0;
 }
 
+/* Sort instances into the order they should be allocated in */
+GListPtr
+sort_clone_instances(GListPtr children)
+{
+	GListPtr keys = NULL;
+	GListPtr gIter = NULL;
+
+	slist_iter(
+		child, resource_t, children, lpc,
+		keys = g_list_append(keys, new_clone_sort_key(child));
+		);
+
+	keys = g_list_sort(keys, sort_clone_key);
+
+	gIter = children;
+	slist_iter(
+		key, clone_sort_key_t, keys, lpc,
+		gIter->data = key->rsc;
+		gIter = gIter->next;
+		free_clone_sort_key(key);
+		);
+	g_list_free(keys);
+	return children;
+}
+
 static node_t *
-can_run_instance(resource_t *rsc, node_t *node)
+can_run_instance(resource_t *rsc, node_t *node, node_t **parent_nodes, int size)
 {
 	node_t *local_node = NULL;
 	clone_variant_data_t *clone_data = NULL;
@@ -343,7 +369,7 @@ can_run_instance(resource_t *rsc, node_t *node)
 		goto bail;
 	}
 
-	local_node = parent_node_instance(rsc, node);
+	local_node = node_vector_find(parent_nodes, size, node);
 	get_clone_variant_data(clone_data, rsc->parent);
 
 	if(local_node == NULL) {
@@ -370,8 +396,10 @@ can_run_instance(resource_t *rsc, node_t *node)
 static node_t *
 color_instance(resource_t *rsc, pe_working_set_t *data_set) 
 {
+	int size = 0;
 	node_t *chosen = NULL;
 	node_t *local_node = NULL;
+	node_t **parent_nodes = NULL;
 
 	crm_debug_2("Processing %s", rsc->id);
 
@@ -384,9 +412,11 @@ color_instance(resource_t *rsc, pe_working_set_t *data_set)
 	}
 
 	if(rsc->allowed_nodes) {
+		parent_nodes = node_list_vector(rsc->parent->allowed_nodes, &size);
 		slist_iter(try_node, node_t, rsc->allowed_nodes, lpc,
-			   can_run_instance(rsc, try_node);
+			   can_run_instance(rsc, try_node, parent_nodes, size);
 			);
+		crm_free(parent_nodes);
 	}
 
 	chosen = rsc->cmds->color(rsc, data_set);
@@ -441,7 +471,7 @@ clone_color(resource_t *rsc, pe_working_set_t *data_set)
 	set_bit(rsc->flags, pe_rsc_allocating);
 	crm_debug_2("Processing %s", rsc->id);
 
-	/* this information is used by sort_clone_instance() when deciding in which 
+	/* this information is used by sort_clone_instances() when deciding in which 
 	 * order to allocate clone instances
 	 */
 	slist_iter(
@@ -473,7 +503,7 @@ clone_color(resource_t *rsc, pe_working_set_t *data_set)
 		   }
 		);
 	
-	rsc->children = g_list_sort(rsc->children, sort_clone_instance);
+	rsc->children = sort_clone_instances(rsc->children);
 
 	/* count now tracks the number of clones we have allocated */
 	slist_iter(node, node_t, rsc->allowed_nodes, lpc,
@@ -576,7 +606,7 @@ find_rsc_action(resource_t *rsc, const char *key, gboolean active_only, GListPtr
     action_t *match = NULL;
     GListPtr possible = NULL;
     GListPtr active = NULL;
-    possible = find_actions(rsc->actions, key, NULL);
+    possible = find_actions(rsc->action_index, key, NULL);
 
     if(active_only) {
 	slist_iter(op, action_t, possible, lpc,
@@ -1111,7 +1141,7 @@ static gboolean detect_restart(resource_t *rsc)
     /* Look for restarts */
     action_t *start = NULL;
     char *key = start_key(rsc);
-    GListPtr possible_matches = find_actions(rsc->actions, key, NULL);
+    GListPtr possible_matches = find_actions(rsc->action_index, key, NULL);
     crm_free(key);
 		
     if(possible_matches) {
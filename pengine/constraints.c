@@ -37,7 +37,7 @@
 #include <lib/pengine/utils.h>
 
 #define EXPAND_CONSTRAINT_IDREF(__set, __rsc, __name) do {				\
-	__rsc = pe_find_resource(data_set->resources, __name);		\
+	__rsc = pe_lookup_resource(data_set, __name);		\
 	if(__rsc == NULL) {						\
 	    crm_config_err("%s: No resource found for %s", __set, __name); \
 	    return FALSE;						\
@@ -194,8 +194,8 @@ unpack_simple_rsc_order(xmlNode * xml_obj, pe_working_set_t *data_set)
 		return FALSE;
 	}	
 
-	rsc_then = pe_find_resource(data_set->resources, id_then);
-	rsc_first = pe_find_resource(data_set->resources, id_first);
+	rsc_then = pe_lookup_resource(data_set, id_then);
+	rsc_first = pe_lookup_resource(data_set, id_first);
 
 	if(rsc_then == NULL) {
 		crm_config_err("Constraint %s: no resource found for name '%s'", id, id_then);
@@ -310,7 +310,7 @@ unpack_rsc_location(xmlNode * xml_obj, pe_working_set_t *data_set)
 	gboolean empty = TRUE;
 	const char *id_lh   = crm_element_value(xml_obj, "rsc");
 	const char *id      = crm_element_value(xml_obj, XML_ATTR_ID);
-	resource_t *rsc_lh  = pe_find_resource(data_set->resources, id_lh);
+	resource_t *rsc_lh  = pe_lookup_resource(data_set, id_lh);
 	const char *node    = crm_element_value(xml_obj, "node");
 	const char *score   = crm_element_value(xml_obj, XML_RULE_ATTR_SCORE);
 	
@@ -322,7 +322,7 @@ unpack_rsc_location(xmlNode * xml_obj, pe_working_set_t *data_set)
 
 	if(node != NULL && score != NULL) {
 	    int score_i = char2score(score);
-	    node_t *match = pe_find_node(data_set->nodes, node);
+	    node_t *match = pe_lookup_node(data_set, node);
 
 	    if(match) {
 		rsc2node_new(id, rsc_lh, score_i, match, data_set);
@@ -577,7 +577,7 @@ rsc_colocation_new(const char *id, const char *node_attr, int score,
 		return FALSE;
 	}
 
-	crm_malloc0(new_con, sizeof(rsc_colocation_t));
+	new_con = pe_arena_alloc(data_set, sizeof(rsc_colocation_t));
 	if(new_con == NULL) {
 		return FALSE;
 	}
@@ -612,8 +612,9 @@ rsc_colocation_new(const char *id, const char *node_attr, int score,
 	rsc_rh->rsc_cons_lhs = g_list_insert_sorted(
 		rsc_rh->rsc_cons_lhs, new_con, sort_cons_priority_lh);
 
-	data_set->colocation_constraints = g_list_append(
-		data_set->colocation_constraints, new_con);
+	data_set->colocation_constraints = constraint_append(
+		data_set->colocation_constraints,
+		&data_set->colocation_tail, new_con);
 	
 	return TRUE;
 }
@@ -663,7 +664,7 @@ custom_action_order(
 		return -1;
 	}
 	
-	crm_malloc0(order, sizeof(order_constraint_t));
+	order = pe_arena_alloc(data_set, sizeof(order_constraint_t));
 
 	crm_debug_3("Creating ordering constraint %d",
 		    data_set->order_id);
@@ -677,8 +678,9 @@ custom_action_order(
 	order->lh_action_task = lh_action_task;
 	order->rh_action_task = rh_action_task;
 	
-	data_set->ordering_constraints = g_list_append(
-		data_set->ordering_constraints, order);
+	data_set->ordering_constraints = constraint_append(
+		data_set->ordering_constraints,
+		&data_set->ordering_tail, order);
 	
 	if(lh_rsc != NULL && rh_rsc != NULL) {
 		crm_debug_4("Created ordering constraint %d (%s):"
@@ -737,13 +739,43 @@ static enum pe_ordering get_flags(
 }
 
 
+/* Look up every resource_ref in a set once
+ *
+ * The set expansions below walk the members several times (and the
+ * pairwise ones once per member of the other set).  On error nothing
+ * has been created yet for the set.
+ */
+static gboolean
+unpack_set_members(const char *id, xmlNode *set, GListPtr *members,
+		   pe_working_set_t *data_set)
+{
+    resource_t *resource = NULL;
+
+    *members = NULL;
+    xml_child_iter_filter(
+	set, xml_rsc, XML_TAG_RESOURCE_REF,
+
+	resource = pe_lookup_resource(data_set, ID(xml_rsc));
+	if(resource == NULL) {
+	    crm_config_err("%s: No resource found for %s", id, ID(xml_rsc));
+	    g_list_free(*members);
+	    *members = NULL;
+	    return FALSE;
+	}
+	*members = g_list_prepend(*members, resource);
+	);
+
+    *members = g_list_reverse(*members);
+    return TRUE;
+}
+
 static gboolean
 unpack_order_set(xmlNode *set, int score,
 		 action_t **begin, action_t **end,
 		 action_t **inv_begin, action_t **inv_end, const char *symmetrical, pe_working_set_t *data_set) 
 {
     resource_t *last = NULL;
-    resource_t *resource = NULL;
+    GListPtr members = NULL;
 
     int local_score = score;
     gboolean sequential = FALSE;
@@ -762,6 +794,10 @@ unpack_order_set(xmlNode *set, int score,
     if(action == NULL) {
 	action = RSC_START;
     }
+
+    if(unpack_set_members(id, set, &members, data_set) == FALSE) {
+	return FALSE;
+    }
     
     pseudo_id = crm_concat(id, action, '-');
     end_id    = crm_concat(pseudo_id, "end", '-');
@@ -784,10 +820,8 @@ unpack_order_set(xmlNode *set, int score,
     sequential = crm_is_true(sequential_s);
     flags = get_flags(id, local_score, action, action);
     
-    xml_child_iter_filter(
-	set, xml_rsc, XML_TAG_RESOURCE_REF,
-
-	EXPAND_CONSTRAINT_IDREF(id, resource, ID(xml_rsc));
+    slist_iter(
+	resource, resource_t, members, lpc,
 
 	key = generate_op_key(resource->id, action, 0);
 	custom_action_order(NULL, NULL, *begin, resource, key, NULL,
@@ -827,10 +861,8 @@ unpack_order_set(xmlNode *set, int score,
 
     flags = get_flags(id, local_score, action, action);
     
-    xml_child_iter_filter(
-	set, xml_rsc, XML_TAG_RESOURCE_REF,
-
-	EXPAND_CONSTRAINT_IDREF(id, resource, ID(xml_rsc));
+    slist_iter(
+	resource, resource_t, members, lpc,
 
 	key = generate_op_key(resource->id, action, 0);
 	custom_action_order(NULL, NULL, *inv_begin, resource, key, NULL,
@@ -850,6 +882,7 @@ unpack_order_set(xmlNode *set, int score,
 	);
 
   done:
+    g_list_free(members);
     return TRUE;
 }
 
@@ -994,8 +1027,8 @@ unpack_rsc_order(xmlNode *xml_obj, pe_working_set_t *data_set)
 static gboolean
 unpack_colocation_set(xmlNode *set, int score, pe_working_set_t *data_set) 
 {
+    GListPtr members = NULL;
     resource_t *with = NULL;
-    resource_t *resource = NULL;
     const char *set_id = ID(set);
     const char *role = crm_element_value(set, "role");
     const char *sequential = crm_element_value(set, "sequential");
@@ -1009,11 +1042,13 @@ unpack_colocation_set(xmlNode *set, int score, pe_working_set_t *data_set)
     if(sequential != NULL && crm_is_true(sequential) == FALSE) {
 	return TRUE;
 
+    } else if(unpack_set_members(set_id, set, &members, data_set) == FALSE) {
+	return FALSE;
+
     } else if(local_score >= 0) {
-	xml_child_iter_filter(
-	    set, xml_rsc, XML_TAG_RESOURCE_REF,
+	slist_iter(
+	    resource, resource_t, members, lpc,
 	    
-	    EXPAND_CONSTRAINT_IDREF(set_id, resource, ID(xml_rsc));
 	    if(with != NULL) {
 		crm_debug_2("Colocating %s with %s", resource->id, with->id);
 		rsc_colocation_new(set_id, NULL, local_score, resource, with, role, role, data_set);
@@ -1029,23 +1064,21 @@ unpack_colocation_set(xmlNode *set, int score, pe_working_set_t *data_set)
 	 * else in the set)
 	 */
 	
-	xml_child_iter_filter(
-	    set, xml_rsc, XML_TAG_RESOURCE_REF,
-	    
-	    EXPAND_CONSTRAINT_IDREF(set_id, resource, ID(xml_rsc));
+	slist_iter(
+	    resource, resource_t, members, lpc,
 
-	    xml_child_iter_filter(
-		set, xml_rsc_with, XML_TAG_RESOURCE_REF,
-		if(safe_str_eq(resource->id, ID(xml_rsc_with))) {
+	    slist_iter(
+		with, resource_t, members, lpc2,
+		if(with == resource) {
 		    break;
 		}
-		EXPAND_CONSTRAINT_IDREF(set_id, with, ID(xml_rsc_with));
 		crm_debug_2("Anti-Colocating %s with %s", resource->id, with->id);
 		rsc_colocation_new(set_id, NULL, local_score, resource, with, role, role, data_set);
 		);
 	    );
     }
     
+    g_list_free(members);
     return TRUE;
 }
 
@@ -1054,6 +1087,8 @@ static gboolean colocate_rsc_sets(
 {
     resource_t *rsc_1 = NULL;
     resource_t *rsc_2 = NULL;
+    GListPtr members_1 = NULL;
+    GListPtr members_2 = NULL;
 	    
     const char *role_1 = crm_element_value(set1, "role");
     const char *role_2 = crm_element_value(set2, "role");
@@ -1061,55 +1096,57 @@ static gboolean colocate_rsc_sets(
     const char *sequential_1 = crm_element_value(set1, "sequential");
     const char *sequential_2 = crm_element_value(set2, "sequential");
 
+    if(unpack_set_members(id, set1, &members_1, data_set) == FALSE) {
+	return FALSE;
+
+    } else if(unpack_set_members(id, set2, &members_2, data_set) == FALSE) {
+	g_list_free(members_1);
+	return FALSE;
+    }
+
     if(crm_is_true(sequential_1)) {
 	/* get the first one */
-	xml_child_iter_filter(
-	    set1, xml_rsc, XML_TAG_RESOURCE_REF,
-	    EXPAND_CONSTRAINT_IDREF(id, rsc_1, ID(xml_rsc));
-	    break;
-	    );
+	rsc_1 = g_list_nth_data(members_1, 0);
     }
 
     if(crm_is_true(sequential_2)) {
 	/* get the last one */
-	const char *rid = NULL;
-	xml_child_iter_filter(
-	    set2, xml_rsc, XML_TAG_RESOURCE_REF,
-	    rid = ID(xml_rsc);
-	    );
-	EXPAND_CONSTRAINT_IDREF(id, rsc_2, rid);
+	rsc_2 = g_list_nth_data(g_list_last(members_2), 0);
+	if(rsc_2 == NULL) {
+	    crm_config_err("%s: set %s has no members", id, ID(set2));
+	    g_list_free(members_1);
+	    g_list_free(members_2);
+	    return FALSE;
+	}
     }
 
     if(rsc_1 != NULL && rsc_2 != NULL) {
 	rsc_colocation_new(id, NULL, score, rsc_1, rsc_2, role_1, role_2, data_set);
 
     } else if(rsc_1 != NULL) {
-	xml_child_iter_filter(
-	    set2, xml_rsc, XML_TAG_RESOURCE_REF,
-	    EXPAND_CONSTRAINT_IDREF(id, rsc_2, ID(xml_rsc));
-	    rsc_colocation_new(id, NULL, score, rsc_1, rsc_2, role_1, role_2, data_set);
+	slist_iter(
+	    rsc, resource_t, members_2, lpc,
+	    rsc_colocation_new(id, NULL, score, rsc_1, rsc, role_1, role_2, data_set);
 	    );
 
     } else if(rsc_2 != NULL) {
-	xml_child_iter_filter(
-	    set1, xml_rsc, XML_TAG_RESOURCE_REF,
-	    EXPAND_CONSTRAINT_IDREF(id, rsc_1, ID(xml_rsc));
-	    rsc_colocation_new(id, NULL, score, rsc_1, rsc_2, role_1, role_2, data_set);
+	slist_iter(
+	    rsc, resource_t, members_1, lpc,
+	    rsc_colocation_new(id, NULL, score, rsc, rsc_2, role_1, role_2, data_set);
 	    );
 
     } else {
-	xml_child_iter_filter(
-	    set1, xml_rsc, XML_TAG_RESOURCE_REF,
-	    EXPAND_CONSTRAINT_IDREF(id, rsc_1, ID(xml_rsc));
-
-	    xml_child_iter_filter(
-		set2, xml_rsc_2, XML_TAG_RESOURCE_REF,
-		EXPAND_CONSTRAINT_IDREF(id, rsc_2, ID(xml_rsc_2));
-		rsc_colocation_new(id, NULL, score, rsc_1, rsc_2, role_1, role_2, data_set);
+	slist_iter(
+	    rsc, resource_t, members_1, lpc,
+	    slist_iter(
+		rsc_with, resource_t, members_2, lpc2,
+		rsc_colocation_new(id, NULL, score, rsc, rsc_with, role_1, role_2, data_set);
 		);
 	    );
     }
 
+    g_list_free(members_1);
+    g_list_free(members_2);
     return TRUE;
 }
 
@@ -1128,8 +1165,8 @@ static gboolean unpack_simple_colocation(xmlNode *xml_obj, pe_working_set_t *dat
 
     const char *symmetrical = crm_element_value(xml_obj, XML_CONS_ATTR_SYMMETRICAL);
     
-    resource_t *rsc_lh = pe_find_resource(data_set->resources, id_lh);
-    resource_t *rsc_rh = pe_find_resource(data_set->resources, id_rh);
+    resource_t *rsc_lh = pe_lookup_resource(data_set, id_lh);
+    resource_t *rsc_rh = pe_lookup_resource(data_set, id_rh);
     
     if(rsc_lh == NULL) {
 	crm_config_err("No resource (con=%s, rsc=%s)", id, id_lh);
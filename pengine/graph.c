@@ -105,8 +105,8 @@ update_action(action_t *action)
 		   action->runnable?"runnable":"unrunnable",
 		   action->pseudo?"pseudo":action->task);
 	
-	slist_iter(
-		other, action_wrapper_t, action->actions_before, lpc,
+	edge_iter(
+		other, action->actions_before, lpc,
 
 		gboolean other_changed = FALSE;
 		node_t *node = other->action->node;
@@ -331,13 +331,13 @@ update_action(action_t *action)
 		if(other_changed) {
 			do_crm_log_unlikely(log_level, "%s changed, processing after list", other->action->uuid);
 			update_action(other->action);
-			slist_iter(
-				before_other, action_wrapper_t, other->action->actions_after, lpc2,
+			edge_iter(
+				before_other, other->action->actions_after, lpc2,
 				do_crm_log_unlikely(log_level, "%s changed, processing %s", other->action->uuid, before_other->action->uuid);
 				update_action(before_other->action);
 				);
-			slist_iter(
-				before_other, action_wrapper_t, other->action->actions_before, lpc2,
+			edge_iter(
+				before_other, other->action->actions_before, lpc2,
 				do_crm_log_unlikely(log_level, "%s changed, processing %s", other->action->uuid, before_other->action->uuid);
 				update_action(before_other->action);
 				);
@@ -348,14 +348,14 @@ update_action(action_t *action)
 	if(changed) {
 		update_action(action);
 		do_crm_log_unlikely(log_level, "%s changed, processing after list", action->uuid);
-		slist_iter(
-			other, action_wrapper_t, action->actions_after, lpc,
+		edge_iter(
+			other, action->actions_after, lpc,
 			do_crm_log_unlikely(log_level, "%s changed, processing %s", action->uuid, other->action->uuid);
 			update_action(other->action);
 			);
 		do_crm_log_unlikely(log_level, "%s changed, processing before list", action->uuid);
-		slist_iter(
-			other, action_wrapper_t, action->actions_before, lpc,
+		edge_iter(
+			other, action->actions_before, lpc,
 			do_crm_log_unlikely(log_level, "%s changed, processing %s", action->uuid, other->action->uuid);
 			update_action(other->action);
 			);
@@ -540,6 +540,8 @@ action2xml(action_t *action, gboolean as_input)
 	}
 
 	g_hash_table_foreach(action->meta, hash2metafield, args_xml);
+	slist_iter(shared, pe_shared_attrs_t, action->shared_meta, lpc,
+		   g_hash_table_foreach(shared->attrs, hash2metafield, args_xml));
 	if(action->rsc != NULL) {
 	    resource_t *parent = action->rsc;
 	    while(parent != NULL) {
@@ -622,6 +624,34 @@ should_dump_action(action_t *action)
 	return TRUE;
 }
 
+/* Sort 'edges' with g_list_sort() which, unlike g_ptr_array_sort(),
+ * is stable.  The relative order of multiple edges to the same action
+ * decides which one gets dumped.
+ */
+static void
+sort_edges(GPtrArray *edges, GCompareFunc sort_func) 
+{
+	guint lpc = 0;
+	GListPtr sorted = NULL;
+
+	if(edges == NULL || edges->len < 2) {
+		return;
+	}
+
+	for(lpc = edges->len; lpc > 0; lpc--) {
+		sorted = g_list_prepend(sorted, g_ptr_array_index(edges, lpc - 1));
+	}
+
+	sorted = g_list_sort(sorted, sort_func);
+
+	lpc = 0;
+	slist_iter(
+		wrapper, action_wrapper_t, sorted, lpc2,
+		edges->pdata[lpc++] = wrapper;
+		);
+	g_list_free(sorted);
+}
+
 /* lowest to highest */
 static gint sort_action_id(gconstpointer a, gconstpointer b)
 {
@@ -736,6 +766,8 @@ graph_element_from_action(action_t *action, pe_working_set_t *data_set)
 {
 	int last_action = -1;
 	int synapse_priority = 0;
+	int refs_len = 0;
+	char *refs = NULL;
 	xmlNode * syn = NULL;
 	xmlNode * set = NULL;
 	xmlNode * in  = NULL;
@@ -768,10 +800,9 @@ graph_element_from_action(action_t *action, pe_working_set_t *data_set)
 	xml_action = action2xml(action, FALSE);
 	add_node_nocopy(set, crm_element_name(xml_action), xml_action);
 
-	action->actions_before = g_list_sort(
-		action->actions_before, sort_action_id);
+	sort_edges(action->actions_before, sort_action_id);
 	
-	slist_iter(wrapper,action_wrapper_t,action->actions_before,lpc,
+	edge_iter(wrapper, action->actions_before, lpc,
 
 		   if(should_dump_input(last_action, action, wrapper) == FALSE) {
 		       continue;
@@ -780,10 +811,28 @@ graph_element_from_action(action_t *action, pe_working_set_t *data_set)
 		   wrapper->state = pe_link_dumped;	
 		   CRM_CHECK(last_action < wrapper->action->id, ;);
 		   last_action = wrapper->action->id;
+
+		   if(is_set(data_set->flags, pe_flag_compact_graph)) {
+			   /* the TE finds the details in the action's own synapse */
+			   char id_s[32];
+			   int len = snprintf(id_s, sizeof(id_s), "%s%d",
+					      refs?" ":"", wrapper->action->id);
+
+			   crm_realloc(refs, refs_len + len + 1);
+			   strcpy(refs + refs_len, id_s);
+			   refs_len += len;
+			   continue;
+		   }
+		   
 		   input = create_xml_node(in, "trigger");
 		   
 		   xml_action = action2xml(wrapper->action, TRUE);
 		   add_node_nocopy(input, crm_element_name(xml_action), xml_action);
 		);
+
+	if(refs != NULL) {
+		crm_xml_add(in, XML_GRAPH_ATTR_INPUT_REFS, refs);
+		crm_free(refs);
+	}
 }
 
@@ -29,6 +29,7 @@
 
 #include <crm/common/ipc.h>
 #include <crm/pengine/common.h>
+#include <pengine.h>
 
 #if HAVE_LIBXML2
 #  include <libxml/parser.h>
@@ -136,6 +137,7 @@ main(int argc, char ** argv)
 	}
 
 	crm_log_init(CRM_SYSTEM_PENGINE, LOG_INFO, TRUE, FALSE, argc, argv);
+	record_stage_stats = TRUE;
 
 	if(crm_is_writable(PE_STATE_DIR, NULL, CRM_DAEMON_USER, CRM_DAEMON_GROUP, FALSE) == FALSE) {
 	    crm_err("Bad permissions on "PE_STATE_DIR". Terminating");
@@ -175,6 +177,7 @@ main(int argc, char ** argv)
 	
 	mainloop = g_main_new(FALSE);
 	g_main_run(mainloop);
+	pe_archive_flush();
 	
 #if HAVE_LIBXML2
 	xmlCleanupParser();
@@ -207,6 +210,7 @@ usage(const char* cmd, int exit_status)
 void
 pengine_shutdown(int nsig)
 {
+    pe_archive_flush();
     crm_free(ipc_server);
     exit(LSB_EXIT_OK);
 }
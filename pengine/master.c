@@ -26,7 +26,6 @@
 #define VARIANT_CLONE 1
 #include <lib/pengine/variant.h>
 
-extern gint sort_clone_instance(gconstpointer a, gconstpointer b);
 
 extern int master_score(resource_t *rsc, node_t *node, int not_set_value);
 
@@ -157,8 +156,65 @@ master_update_pseudo_status(
 		}							\
 		);
 
+/* A rsc_location with role=Master, indexed by node */
+typedef struct master_location_s 
+{
+	rsc_to_node_t *cons;
+	node_t **nodes;
+	int size;
+} master_location_t;
+
+static GListPtr
+index_master_locations(GListPtr list)
+{
+	GListPtr result = NULL;
+	slist_iter(
+		cons, rsc_to_node_t, list, lpc,
+		master_location_t *location = NULL;
+		if(cons->role_filter != RSC_ROLE_MASTER) {
+			continue;
+		}
+		crm_malloc0(location, sizeof(master_location_t));
+		location->cons = cons;
+		location->nodes = node_list_vector(cons->node_list_rh, &location->size);
+		result = g_list_append(result, location);
+		);
+	return result;
+}
+
+static void
+free_master_locations(GListPtr list)
+{
+	slist_iter(
+		location, master_location_t, list, lpc,
+		crm_free(location->nodes);
+		crm_free(location);
+		);
+	g_list_free(list);
+}
+
+/* Same as apply_master_location() but without the per-node list scans */
+static void
+apply_master_locations(resource_t *child_rsc, node_t *chosen, GListPtr list)
+{
+	slist_iter(
+		location, master_location_t, list, lpc,
+		node_t *cons_node = NULL;
+		crm_debug_2("Applying %s to %s",
+			    location->cons->id, child_rsc->id);
+		cons_node = node_vector_find(location->nodes, location->size, chosen);
+		if(cons_node != NULL) {
+			int new_priority = merge_weights(
+				child_rsc->priority, cons_node->weight);
+			crm_debug_2("\t%s: %d->%d (%d)", child_rsc->id,
+				    child_rsc->priority, new_priority, cons_node->weight);
+			child_rsc->priority = new_priority;
+		}
+		);
+}
+
 static node_t *
-can_be_master(resource_t *rsc)
+can_be_master(resource_t *rsc, node_t **parent_nodes, int size)
 {
 	node_t *node = NULL;
 	node_t *local_node = NULL;
@@ -174,7 +230,7 @@ can_be_master(resource_t *rsc)
 	if(rsc->children) {
 	    slist_iter(
 		child, resource_t, rsc->children, lpc,
-		if(can_be_master(child) == NULL) {
+		if(can_be_master(child, parent_nodes, size) == NULL) {
 		    do_crm_log_unlikely(level, "Child %s of %s can't be promoted", child->id, rsc->id);
 		    return NULL;
 		}
@@ -207,8 +263,7 @@ can_be_master(resource_t *rsc)
 	}
 	
 	get_clone_variant_data(clone_data, parent);
-	local_node = pe_find_node_id(
-		parent->allowed_nodes, node->details->id);
+	local_node = node_vector_find(parent_nodes, size, node);
 
 	if(local_node == NULL) {
 		crm_err("%s cannot run on %s: node not allowed",
@@ -227,40 +282,82 @@ can_be_master(resource_t *rsc)
 	return NULL;
 }
 
+/* An instance's place in the promotion order
+ *
+ * The role is looked up once, and the clone allocation key used to
+ * break ties is only built when two instances actually tie.
+ */
+typedef struct promotion_entry_s 
+{
+	resource_t *rsc;
+	enum rsc_role_e role;
+	clone_sort_key_t *key;
+} promotion_entry_t;
+
 static gint sort_master_instance(gconstpointer a, gconstpointer b)
 {
 	int rc;
-	enum rsc_role_e role1 = RSC_ROLE_UNKNOWN;
-	enum rsc_role_e role2 = RSC_ROLE_UNKNOWN;
-
-	const resource_t *resource1 = (const resource_t*)a;
-	const resource_t *resource2 = (const resource_t*)b;
+	promotion_entry_t *entry1 = (promotion_entry_t*)a;
+	promotion_entry_t *entry2 = (promotion_entry_t*)b;
 
-	CRM_ASSERT(resource1 != NULL);
-	CRM_ASSERT(resource2 != NULL);
+	CRM_ASSERT(entry1->rsc != NULL);
+	CRM_ASSERT(entry2->rsc != NULL);
 
-	role1 = resource1->fns->state(resource1, TRUE);
-	role2 = resource2->fns->state(resource2, TRUE);
-	
-	rc = sort_rsc_index(a, b);
+	rc = sort_rsc_index(entry1->rsc, entry2->rsc);
 	if( rc != 0 ) {
 		return rc;
 	}
 	
-	if(role1 > role2) {
+	if(entry1->role > entry2->role) {
 		return -1;
 
-	} else if(role1 < role2) {
+	} else if(entry1->role < entry2->role) {
 		return 1;
 	}
-	
-	return sort_clone_instance(a, b);
+
+	if(entry1->key == NULL) {
+		entry1->key = new_clone_sort_key(entry1->rsc);
+	}
+	if(entry2->key == NULL) {
+		entry2->key = new_clone_sort_key(entry2->rsc);
+	}
+	return sort_clone_key(entry1->key, entry2->key);
+}
+
+static GListPtr
+sort_promotion_order(GListPtr children)
+{
+	GListPtr entries = NULL;
+	GListPtr gIter = children;
+
+	slist_iter(
+		child, resource_t, children, lpc,
+		promotion_entry_t *entry = NULL;
+		crm_malloc0(entry, sizeof(promotion_entry_t));
+		entry->rsc = child;
+		entry->role = child->fns->state(child, TRUE);
+		entries = g_list_append(entries, entry);
+		);
+
+	entries = g_list_sort(entries, sort_master_instance);
+
+	slist_iter(
+		entry, promotion_entry_t, entries, lpc,
+		gIter->data = entry->rsc;
+		gIter = gIter->next;
+		free_clone_sort_key(entry->key);
+		crm_free(entry);
+		);
+	g_list_free(entries);
+	return children;
 }
 
 static void master_promotion_order(resource_t *rsc) 
 {
+    int size = 0;
     node_t *node = NULL;
     node_t *chosen = NULL;
+    node_t **allowed = NULL;
     clone_variant_data_t *clone_data = NULL;
     get_clone_variant_data(clone_data, rsc);
 
@@ -277,6 +374,7 @@ static void master_promotion_order(resource_t *rsc)
 	);
     dump_node_scores(LOG_DEBUG_3, rsc, "Before", rsc->allowed_nodes);
 
+    allowed = node_list_vector(rsc->allowed_nodes, &size);
     slist_iter(
 	child, resource_t, rsc->children, lpc,
 
@@ -286,12 +384,12 @@ static void master_promotion_order(resource_t *rsc)
 	    continue;
 	}
 
-	node = (node_t*)pe_find_node_id(
-	    rsc->allowed_nodes, chosen->details->id);
+	node = node_vector_find(allowed, size, chosen);
 	CRM_ASSERT(node != NULL);
 	/* adds in master preferences and rsc_location.role=Master */
 	node->weight = merge_weights(child->sort_index, node->weight);
 	);
+    crm_free(allowed);
     
     dump_node_scores(LOG_DEBUG_3, rsc, "Middle", rsc->allowed_nodes);
 
@@ -328,6 +426,7 @@ static void master_promotion_order(resource_t *rsc)
     dump_node_scores(LOG_DEBUG_3, rsc, "After", rsc->allowed_nodes);
 
     /* write them back and sort */
+    allowed = node_list_vector(rsc->allowed_nodes, &size);
     slist_iter(
 	child, resource_t, rsc->children, lpc,
 
@@ -339,16 +438,18 @@ static void master_promotion_order(resource_t *rsc)
 	    crm_debug_2("%s: %d", child->id, child->sort_index);
 
 	} else {
-	    node = (node_t*)pe_find_node_id(
-		rsc->allowed_nodes, chosen->details->id);
+	    node = node_vector_find(allowed, size, chosen);
 	    CRM_ASSERT(node != NULL);
 
 	    child->sort_index = node->weight;
 	}
 	crm_debug_2("%s: %d", child->id, child->sort_index);
 	);
+    crm_free(allowed);
 
-    rsc->children = g_list_sort(rsc->children, sort_master_instance);
+    rsc_merge_weights_cache_begin();
+    rsc->children = sort_promotion_order(rsc->children);
+    rsc_merge_weights_cache_end();
     clear_bit(rsc->flags, pe_rsc_merging);
 }
 
@@ -512,9 +613,12 @@ static void set_role_master(resource_t *rsc)
 node_t *
 master_color(resource_t *rsc, pe_working_set_t *data_set)
 {
+	int size = 0;
 	int promoted = 0;
 	node_t *chosen = NULL;
 	node_t *cons_node = NULL;
+	node_t **allowed = NULL;
+	GListPtr master_locations = NULL;
 	enum rsc_role_e next_role = RSC_ROLE_UNKNOWN;
 	
 	clone_variant_data_t *clone_data = NULL;
@@ -542,6 +646,7 @@ master_color(resource_t *rsc, pe_working_set_t *data_set)
 	/*
 	 * assign priority
 	 */
+	master_locations = index_master_locations(rsc->rsc_location);
 	slist_iter(
 		child_rsc, resource_t, rsc->children, lpc,
 
@@ -594,7 +699,7 @@ master_color(resource_t *rsc, pe_working_set_t *data_set)
 		}
 
 		apply_master_location(child_rsc->rsc_location);
-		apply_master_location(rsc->rsc_location);
+		apply_master_locations(child_rsc, chosen, master_locations);
 		slist_iter(
 		    cons, rsc_colocation_t, child_rsc->rsc_cons, lpc2,
 		    child_rsc->cmds->rsc_colocation_lh(child_rsc, cons->rsc_rh, cons);
@@ -608,11 +713,13 @@ master_color(resource_t *rsc, pe_working_set_t *data_set)
 		}
 
 	    );
+	free_master_locations(master_locations);
 
 	dump_node_scores(LOG_DEBUG_3, rsc, "Pre merge", rsc->allowed_nodes);
 	master_promotion_order(rsc);
 
 	/* mark the first N as masters */
+	allowed = node_list_vector(rsc->allowed_nodes, &size);
 	slist_iter(
 		child_rsc, resource_t, rsc->children, lpc,
 
@@ -634,7 +741,7 @@ master_color(resource_t *rsc, pe_working_set_t *data_set)
 		    crm_debug_2("Not supposed to promote child: %s", child_rsc->id);
 		    
 		} else if(promoted < clone_data->master_max || is_not_set(rsc->flags, pe_rsc_managed)) {
-			chosen = can_be_master(child_rsc);
+			chosen = can_be_master(child_rsc, allowed, size);
 		}
 
 		crm_debug("%s master score: %d", child_rsc->id, child_rsc->priority);
@@ -650,6 +757,7 @@ master_color(resource_t *rsc, pe_working_set_t *data_set)
 		set_role_master(child_rsc);
 		promoted++;		
 		);
+	crm_free(allowed);
 	
 	clone_data->masters_allocated = promoted;
 	crm_info("%s: Promoted %d instances of a possible %d to master",
@@ -173,20 +173,81 @@ int node_list_attr_score(GListPtr list, const char *attr, const char *value)
 }
 
 
+typedef struct attr_score_s 
+{
+	int score;
+	const char *uname;
+} attr_score_t;
+
+/* Calculate node_list_attr_score() for every value of attr in one pass
+ * 
+ * Nodes without a value for attr are tallied in *unset
+ */
+static GHashTable *
+node_list_attr_scores(GListPtr list, const char *attr, attr_score_t *unset)
+{
+    GHashTable *scores = g_hash_table_new_full(
+	crm_strcase_hash, crm_strcase_equal, NULL, g_hash_destroy_str);
+
+    slist_iter(node, node_t, list, lpc,
+	       int weight = node->weight;
+	       const char *value = g_hash_table_lookup(node->details->attrs, attr);
+	       attr_score_t *best = unset;
+
+	       if(can_run_resources(node) == FALSE) {
+		   weight = -INFINITY;
+	       }
+	       if(value != NULL) {
+		   best = g_hash_table_lookup(scores, value);
+		   if(best == NULL) {
+		       crm_malloc0(best, sizeof(attr_score_t));
+		       best->score = -INFINITY;
+		       g_hash_table_insert(scores, (gpointer)value, best);
+		   }
+	       }
+	       if(weight > best->score || best->uname == NULL) {
+		   best->score = weight;
+		   best->uname = node->details->uname;
+	       }
+	);
+
+    return scores;
+}
+
 static void
 node_list_update(GListPtr list1, GListPtr list2, const char *attr, int factor, gboolean only_positive)
 {
     int score = 0;
     int new_score = 0;
+    GHashTable *scores = NULL;
+    attr_score_t unset = { -INFINITY, NULL };
+
     if(attr == NULL) {
 	attr = "#"XML_ATTR_UNAME;
     }
+
+    scores = node_list_attr_scores(list2, attr, &unset);
     
     slist_iter(
 	node, node_t, list1, lpc,
 	
+	const char *value = NULL;
+	attr_score_t *best = &unset;
+
 	CRM_CHECK(node != NULL, continue);
-	score = node_list_attr_score(list2, attr, g_hash_table_lookup(node->details->attrs, attr));
+	value = g_hash_table_lookup(node->details->attrs, attr);
+	if(value != NULL) {
+	    best = g_hash_table_lookup(scores, value);
+	}
+
+	score = -INFINITY;
+	if(best != NULL && best->uname != NULL) {
+	    score = best->score;
+	}
+	if(safe_str_neq(attr, "#"XML_ATTR_UNAME)) {
+	    crm_info("Best score for %s=%s was %s with %d",
+		     attr, crm_str(value), (best && best->uname)?best->uname:"<none>", score);
+	}
 	new_score = merge_weights(factor*score, node->weight);
 	
 	if(factor < 0 && score < 0) {
@@ -218,11 +279,123 @@ node_list_update(GListPtr list1, GListPtr list2, const char *attr, int factor, g
 	    node->weight = new_score;
 	}
 	);
+
+    g_hash_table_destroy(scores);
+}
+
+/* Results of top-level rsc_merge_weights() calls
+ *
+ * Only populated between rsc_merge_weights_cache_begin() and
+ * rsc_merge_weights_cache_end(), which callers use to bracket
+ * sections that repeat the same merges without changing any
+ * rsc->allowed_nodes (eg. sorting clone instances).
+ */
+static GHashTable *merge_cache = NULL;
+static int merge_depth = 0;
+
+static void
+free_cached_merge(gpointer data)
+{
+    pe_free_shallow((GListPtr)data);
+}
+
+static gboolean
+remove_cached_merge(gpointer key, gpointer value, gpointer user_data)
+{
+    return TRUE;
+}
+
+void
+rsc_merge_weights_cache_begin(void)
+{
+    CRM_CHECK(merge_cache == NULL, return);
+    merge_cache = g_hash_table_new_full(
+	g_str_hash, g_str_equal, g_hash_destroy_str, free_cached_merge);
+}
+
+void
+rsc_merge_weights_cache_end(void)
+{
+    if(merge_cache != NULL) {
+	g_hash_table_destroy(merge_cache);
+	merge_cache = NULL;
+    }
+}
+
+void
+rsc_merge_weights_cache_flush(void)
+{
+    if(merge_cache != NULL) {
+	g_hash_table_foreach_remove(merge_cache, remove_cached_merge, NULL);
+    }
+}
+
+static char *
+merge_cache_key(resource_t *rsc, GListPtr nodes, const char *attr,
+		int factor, gboolean allow_rollback, gboolean only_positive)
+{
+    int offset = 0;
+    char *key = NULL;
+    int max = 64 + strlen(rsc->id) + (attr?strlen(attr):0) + 24 * g_list_length(nodes);
+
+    crm_malloc0(key, max);
+    offset += snprintf(key + offset, max - offset, "%s %s %d %d %d",
+		       rsc->id, crm_str(attr), factor, allow_rollback, only_positive);
+
+    slist_iter(
+	node, node_t, nodes, lpc,
+	offset += snprintf(key + offset, max - offset, " %d=%d",
+			   node->details->index, node->weight);
+	);
+    return key;
 }
 
+static GListPtr
+merge_weights_worker(resource_t *rsc, const char *rhs, GListPtr nodes, const char *attr,
+		     int factor, gboolean allow_rollback, gboolean only_positive);
+
 GListPtr
 rsc_merge_weights(resource_t *rsc, const char *rhs, GListPtr nodes, const char *attr,
 		  int factor, gboolean allow_rollback, gboolean only_positive) 
+{
+    char *key = NULL;
+    GListPtr cached = NULL;
+    
+    if(merge_cache == NULL || merge_depth > 0) {
+	/* Nested results depend on which resources are already being
+	 * merged, so only the outermost call is safe to remember
+	 */
+	GListPtr result = NULL;
+
+	merge_depth++;
+	result = merge_weights_worker(
+	    rsc, rhs, nodes, attr, factor, allow_rollback, only_positive);
+	merge_depth--;
+	return result;
+    }
+
+    key = merge_cache_key(rsc, nodes, attr, factor, allow_rollback, only_positive);
+    cached = g_hash_table_lookup(merge_cache, key);
+    if(cached == NULL) {
+	merge_depth++;
+	nodes = merge_weights_worker(
+	    rsc, rhs, nodes, attr, factor, allow_rollback, only_positive);
+	merge_depth--;
+
+	crm_debug_3("%s: Caching scores from %s", rhs, rsc->id);
+	g_hash_table_insert(merge_cache, key, node_list_dup(nodes, FALSE, FALSE));
+	return nodes;
+    }
+
+    crm_debug_3("%s: Re-using scores from %s", rhs, rsc->id);
+    slist_destroy(node_t, n, nodes, crm_free(n));
+    crm_free(key);
+    return node_list_dup(cached, FALSE, FALSE);
+}
+
+static GListPtr
+merge_weights_worker(resource_t *rsc, const char *rhs, GListPtr nodes, const char *attr,
+		     int factor, gboolean allow_rollback, gboolean only_positive) 
 {
     GListPtr work = NULL;
     int multiplier = 1;
@@ -479,7 +652,7 @@ RecurringOp(resource_t *rsc, action_t *start, node_t *node,
 	}
 
 	/* start a monitor for an already active resource */
-	possible_matches = find_actions_exact(rsc->actions, key, node);
+	possible_matches = find_actions_exact(rsc->action_index, key, node);
 	if(possible_matches == NULL) {
 		is_optional = FALSE;
 		crm_debug_3("Marking %s manditory: not active", key);
@@ -502,8 +675,7 @@ RecurringOp(resource_t *rsc, action_t *start, node_t *node,
 				rsc, local_key, RSC_CANCEL, node,
 				FALSE, TRUE, data_set);
 
-			crm_free(mon->task);
-			mon->task = crm_strdup(RSC_CANCEL);
+			rename_action(mon, RSC_CANCEL, NULL, data_set);
 			add_hash_param(mon->meta, XML_LRM_ATTR_INTERVAL, interval);
 			add_hash_param(mon->meta, XML_LRM_ATTR_TASK, name);
 
@@ -642,7 +814,7 @@ void native_create_actions(resource_t *rsc, pe_working_set_t *data_set)
 
 	} else if(rsc->role == RSC_ROLE_STOPPED && rsc->next_role == RSC_ROLE_STOPPED) {
 		char *key = start_key(rsc);
-		GListPtr possible_matches = find_actions(rsc->actions, key, NULL);
+		GListPtr possible_matches = find_actions(rsc->action_index, key, NULL);
 		slist_iter(
 			action, action_t, possible_matches, lpc,
 			action->optional = TRUE;
@@ -887,11 +1059,11 @@ void native_rsc_colocation_rh(
 	}
 }
 
-static GListPtr find_actions_by_task(GListPtr actions, resource_t *rsc, const char *original_key)
+static GListPtr find_actions_by_task(pe_action_index_t *index, resource_t *rsc, const char *original_key)
 {
     GListPtr list = NULL;
 
-    list = find_actions(actions, original_key, NULL);
+    list = find_actions(index, original_key, NULL);
     if(list == NULL) {
 	/* we're potentially searching a child of the original resource */
 	char *key = NULL;
@@ -903,7 +1075,7 @@ static GListPtr find_actions_by_task(GListPtr actions, resource_t *rsc, const ch
 	    /* crm_err("looking up %s instead of %s", key, original_key); */
 	    /* slist_iter(action, action_t, actions, lpc, */
 	    /* 	       crm_err("  - %s", action->uuid)); */
-	    list = find_actions(actions, key, NULL);
+	    list = find_actions(index, key, NULL);
 	    
 	} else {
 	    crm_err("search key: %s", original_key);
@@ -931,7 +1103,7 @@ void native_rsc_order_lh(resource_t *lh_rsc, order_constraint_t *order, pe_worki
 
 	} else if(lh_action == NULL) {
 		lh_actions = find_actions_by_task(
-		    lh_rsc->actions, lh_rsc, order->lh_action_task);
+		    lh_rsc->action_index, lh_rsc, order->lh_action_task);
 	}
 
 	if(lh_actions == NULL && lh_rsc != rh_rsc) {
@@ -1001,7 +1173,7 @@ void native_rsc_order_rh(
 
 	} else if(rsc != NULL) {
 		rh_actions = find_actions_by_task(
-		    rsc->actions, rsc, order->rh_action_task);
+		    rsc->action_index, rsc, order->rh_action_task);
 	}
 
 	if(rh_actions == NULL) {
@@ -1139,7 +1311,7 @@ LogActions(resource_t *rsc, pe_working_set_t *data_set)
     if(rsc->role == rsc->next_role) {
 	action_t *start = NULL;
 	char *key = start_key(rsc);
-	GListPtr possible_matches = find_actions(rsc->actions, key, next);
+	GListPtr possible_matches = find_actions(rsc->action_index, key, next);
 	crm_free(key);
 
 	if(possible_matches) {
@@ -1148,7 +1320,7 @@ LogActions(resource_t *rsc, pe_working_set_t *data_set)
 	}
 
 	key = generate_op_key(rsc->id, CRMD_ACTION_MIGRATED, 0);
-	possible_matches = find_actions(rsc->actions, key, next);
+	possible_matches = find_actions(rsc->action_index, key, next);
 	crm_free(key);
 	
 	CRM_CHECK(next != NULL,);
@@ -1345,7 +1517,7 @@ PromoteRsc(resource_t *rsc, node_t *next, gboolean optional, pe_working_set_t *d
 	CRM_CHECK(next != NULL, return FALSE);
 
 	key = start_key(rsc);
-	action_list = find_actions_exact(rsc->actions, key, next);
+	action_list = find_actions_exact(rsc->action_index, key, next);
 	crm_free(key);
 
 	slist_iter(start, action_t, action_list, lpc,
@@ -1364,7 +1536,7 @@ PromoteRsc(resource_t *rsc, node_t *next, gboolean optional, pe_working_set_t *d
 	crm_debug("%s\tPromote %s (canceled)", next->details->uname, rsc->id);
 
 	key = promote_key(rsc);
-	action_list = find_actions_exact(rsc->actions, key, next);
+	action_list = find_actions_exact(rsc->action_index, key, next);
 	crm_free(key);
 
 	slist_iter(promote, action_t, action_list, lpc,
@@ -1505,7 +1677,7 @@ native_create_probe(resource_t *rsc, node_t *node, action_t *complete,
 		    return FALSE;
 		}
 		clone_id = increment_clone(clone_id);
-		peer = pe_find_resource(data_set->resources, clone_id);
+		peer = pe_lookup_resource(data_set, clone_id);
 	    }
 	    
 	    crm_free(clone_id);
@@ -1599,7 +1771,7 @@ native_stop_constraints(
 	resource_t *top = uber_parent(rsc);
 	
 	key = stop_key(rsc);
-	action_list = find_actions(rsc->actions, key, stonith_op->node);
+	action_list = find_actions(rsc->action_index, key, stonith_op->node);
 	crm_free(key);
 
 	/* add the stonith OP as a stop pre-req and the mark the stop
@@ -1633,7 +1805,7 @@ native_stop_constraints(
 	    action->implied_by_stonith = TRUE;
 	    
 	    if(is_stonith == FALSE) {
-		action_t *parent_stop = find_first_action(top->actions, NULL, RSC_STOP, NULL);
+		action_t *parent_stop = find_first_action(top->action_index, NULL, RSC_STOP, NULL);
 		
 		order_actions(stonith_op, action, pe_order_optional);
 		order_actions(stonith_op, parent_stop, pe_order_optional);
@@ -1664,8 +1836,8 @@ native_stop_constraints(
 		crm_info("Creating secondary notification for %s", action->uuid);
 
 		collect_notification_data(rsc, TRUE, FALSE, n_data);
-		g_hash_table_insert(n_data->keys, crm_strdup("notify_stop_resource"), crm_strdup(rsc->id));
-		g_hash_table_insert(n_data->keys, crm_strdup("notify_stop_uname"), crm_strdup(action->node->details->uname));
+		g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_stop_resource"), crm_strdup(rsc->id));
+		g_hash_table_insert(n_data->keys->attrs, crm_strdup("notify_stop_uname"), crm_strdup(action->node->details->uname));
 		create_notifications(uber_parent(rsc), n_data, data_set);
 		free_notification_data(n_data);
 	    }
@@ -1719,7 +1891,7 @@ native_stop_constraints(
 	g_list_free(action_list);
 
 	key = demote_key(rsc);
-	action_list = find_actions(rsc->actions, key, stonith_op->node);
+	action_list = find_actions(rsc->action_index, key, stonith_op->node);
 	crm_free(key);
 	
 	slist_iter(
@@ -1805,13 +1977,13 @@ find_clone_activity_on(resource_t *rsc, resource_t *target, node_t *node, const
 	return mode;
     }
 
-    active = find_first_action(target->actions, NULL, CRMD_ACTION_START, NULL);
+    active = find_first_action(target->action_index, NULL, CRMD_ACTION_START, NULL);
     if(active && active->optional == FALSE && active->pseudo == FALSE) {
 	crm_debug("%s: found scheduled %s action (%s)", rsc->id, active->uuid, type);
 	mode |= stack_starting;
     }
 
-    active = find_first_action(target->actions, NULL, CRMD_ACTION_STOP, node);
+    active = find_first_action(target->action_index, NULL, CRMD_ACTION_STOP, node);
     if(active && active->optional == FALSE && active->pseudo == FALSE) {
 	crm_debug("%s: found scheduled %s action (%s)", rsc->id, active->uuid, type);
 	mode |= stack_stopping;
@@ -1911,7 +2083,7 @@ at_stack_bottom(resource_t *rsc)
     GListPtr action_list = NULL;
 
     key = start_key(rsc);
-    action_list = find_actions(rsc->actions, key, NULL);
+    action_list = find_actions(rsc->action_index, key, NULL);
     crm_free(key);
     
     crm_debug_3("%s: processing", rsc->id);
@@ -1938,8 +2110,8 @@ at_stack_bottom(resource_t *rsc)
 	}
 	);
 
-    slist_iter(
-	other_w, action_wrapper_t, start->actions_before, lpc,
+    edge_iter(
+	other_w, start->actions_before, lpc,
 	other = other_w->action;
 
 #if ALLOW_WEAK_MIGRATION
@@ -1974,7 +2146,7 @@ get_first_named_action(resource_t *rsc, const char *action, gboolean only_valid)
 {
 	action_t *a = NULL;
 	char *key = generate_op_key(rsc->id, action, 0);
-	GListPtr action_list = find_actions(rsc->actions, key, NULL);
+	GListPtr action_list = find_actions(rsc->action_index, key, NULL);
 
 
 	crm_free(key);
@@ -2043,10 +2215,8 @@ MigrateRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
 	     stop->node->details->uname,
 	     start->node->details->uname);
 		
-    crm_free(stop->uuid);
-    crm_free(stop->task);
-    stop->task = crm_strdup(RSC_MIGRATE);
-    stop->uuid = generate_op_key(rsc->id, stop->task, 0);
+    rename_action(stop, RSC_MIGRATE,
+		  generate_op_key(rsc->id, RSC_MIGRATE, 0), data_set);
     add_hash_param(stop->meta, "migrate_source",
 		   stop->node->details->uname);
     add_hash_param(stop->meta, "migrate_target",
@@ -2062,8 +2232,8 @@ MigrateRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
 
 	if(constraint->score > 0) {
 	    int mode = check_stack_element(rsc, target, "coloc");
-	    action_t *clone_stop = find_first_action(target->actions, NULL, RSC_STOP, NULL);
-	    action_t *clone_start = find_first_action(target->actions, NULL, RSC_STARTED, NULL);
+	    action_t *clone_stop = find_first_action(target->action_index, NULL, RSC_STOP, NULL);
+	    action_t *clone_start = find_first_action(target->action_index, NULL, RSC_STARTED, NULL);
 
 	    CRM_ASSERT(clone_stop != NULL);
 	    CRM_ASSERT(clone_start != NULL);
@@ -2071,14 +2241,14 @@ MigrateRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
 	    CRM_ASSERT(((mode & stack_stopping) && (mode & stack_starting)) == 0);
 
 	    if(mode & stack_stopping) {
-		action_t *clone_stop = find_first_action(target->actions, NULL, RSC_STOP, NULL);
-		action_t *clone_start = find_first_action(target->actions, NULL, RSC_STARTED, NULL);
+		action_t *clone_stop = find_first_action(target->action_index, NULL, RSC_STOP, NULL);
+		action_t *clone_start = find_first_action(target->action_index, NULL, RSC_STARTED, NULL);
 		crm_debug("Creating %s.start -> %s.stop ordering", rsc->id, target->id);
 
 		order_actions(start, clone_stop, pe_order_optional);
 
-		slist_iter(
-		    other_w, action_wrapper_t, start->actions_before, lpc2,
+		edge_iter(
+		    other_w, start->actions_before, lpc2,
 		    /* Needed if the clone's started pseudo-action ever gets printed in the graph */ 
 		    if(other_w->action == clone_start) {
 			crm_debug("Breaking %s -> %s ordering", other_w->action->uuid, start->uuid);
@@ -2091,8 +2261,8 @@ MigrateRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
 
 		order_actions(clone_start, stop, pe_order_optional);
 			    
-		slist_iter(
-		    other_w, action_wrapper_t, clone_stop->actions_before, lpc2,
+		edge_iter(
+		    other_w, clone_stop->actions_before, lpc2,
 		    /* Needed if the clone's stop pseudo-action ever gets printed in the graph */ 
 		    if(other_w->action == stop) {
 			crm_debug("Breaking %s -> %s ordering", other_w->action->uuid, clone_stop->uuid);
@@ -2103,17 +2273,15 @@ MigrateRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
 	}
 	);
 
-    crm_free(start->uuid);
-    crm_free(start->task);
-    start->task = crm_strdup(RSC_MIGRATED);
-    start->uuid = generate_op_key(rsc->id, start->task, 0);
+    rename_action(start, RSC_MIGRATED,
+		  generate_op_key(rsc->id, RSC_MIGRATED, 0), data_set);
     add_hash_param(start->meta, "migrate_source_uuid", stop->node->details->id);
     add_hash_param(start->meta, "migrate_source", stop->node->details->uname);
     add_hash_param(start->meta, "migrate_target", start->node->details->uname);
 
     /* Anything that needed stop to complete, now also needs start to have completed */
-    slist_iter(
-	other_w, action_wrapper_t, stop->actions_after, lpc,
+    edge_iter(
+	other_w, stop->actions_after, lpc,
 	other = other_w->action;
 	if(other->optional || other->rsc != NULL) {
 	    continue;
@@ -2123,8 +2291,8 @@ MigrateRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
 	);
 
     /* Stop also needs anything that the start needed to have completed too */
-    slist_iter(
-	other_w, action_wrapper_t, start->actions_before, lpc,
+    edge_iter(
+	other_w, start->actions_before, lpc,
 	other = other_w->action;
 	if(other->rsc == NULL) {
 	    /* nothing */
@@ -2192,10 +2360,8 @@ ReloadRsc(resource_t * rsc, action_t *stop, action_t *start, pe_working_set_t *
     set_bit(rsc->flags, pe_rsc_reload);
     rewrite->optional = FALSE;
 
-    crm_free(rewrite->uuid);
-    crm_free(rewrite->task);
-    rewrite->task = crm_strdup("reload");
-    rewrite->uuid = generate_op_key(rsc->id, rewrite->task, 0);
+    rename_action(rewrite, "reload",
+		  generate_op_key(rsc->id, "reload", 0), data_set);
 }
 
 void
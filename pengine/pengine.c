@@ -38,6 +38,7 @@ xmlNode * do_calculations(
 	pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now);
 
 gboolean show_scores = FALSE;
+gboolean record_stage_stats = FALSE;
 int scores_log_level = LOG_DEBUG_2;
 extern int transition_id;
 
@@ -49,15 +50,35 @@ typedef struct series_s
 	const char *name;
 	const char *param;
 	int wrap;
+	int next;	/* -1 until read from disk */
 } series_t;
 
 series_t series[] = {
-	{ 0, "pe-unknown", "_dont_match_anything_", -1 },
-	{ 0, "pe-error",   "pe-error-series-max", -1 },
-	{ 0, "pe-warn",    "pe-warn-series-max", 200 },
-	{ 0, "pe-input",   "pe-input-series-max", 400 },
+	{ 0, "pe-unknown", "_dont_match_anything_", -1, -1 },
+	{ 0, "pe-error",   "pe-error-series-max", -1, -1 },
+	{ 0, "pe-warn",    "pe-warn-series-max", 200, -1 },
+	{ 0, "pe-input",   "pe-input-series-max", 400, -1 },
 };
 
+/* The writer may not have updated the .last file yet, so only
+ * read it once and keep count here from then on
+ */
+static int
+next_sequence(series_t *a_series, int wrap)
+{
+	int seq = a_series->next;
+
+	if(seq < 0) {
+		seq = get_last_sequence(PE_STATE_DIR, a_series->name);
+	}
+
+	a_series->next = seq + 1;
+	if(wrap > 0 && a_series->next >= wrap) {
+		a_series->next = 0;
+	}
+	return seq;
+}
+
 gboolean
 process_pe_message(xmlNode *msg, xmlNode *xml_data, IPC_Channel *sender)
 {
@@ -86,6 +107,9 @@ process_pe_message(xmlNode *msg, xmlNode *xml_data, IPC_Channel *sender)
 		int seq = -1;
 		int series_id = 0;
 		int series_wrap = 0;
+		int compress_level = 5;
+		int keyframes = 0;
+		gboolean archive_async = TRUE;
 		char *filename = NULL;
 		char *graph_file = NULL;
 		const char *value = NULL;
@@ -93,11 +117,7 @@ process_pe_message(xmlNode *msg, xmlNode *xml_data, IPC_Channel *sender)
 		xmlNode *converted = NULL;
 		xmlNode *reply = NULL;
 		gboolean process = TRUE;
-#if HAVE_BZLIB_H
-		gboolean compress = TRUE;
-#else
 		gboolean compress = FALSE;
-#endif
 
 		crm_config_error = FALSE;
 		crm_config_warning = FALSE;	
@@ -137,7 +157,41 @@ process_pe_message(xmlNode *msg, xmlNode *xml_data, IPC_Channel *sender)
 					series[series_id].param);
 		}		
 
-		seq = get_last_sequence(PE_STATE_DIR, series[series_id].name);	
+		value = pe_pref(data_set.config_hash, "pe-input-compression");
+		if(value != NULL) {
+			compress_level = crm_parse_int(value, "5");
+			if(compress_level < 0 || compress_level > 9) {
+				compress_level = 5;
+			}
+		}
+#if HAVE_BZLIB_H
+		compress = compress_level > 0;
+#endif
+		if(compress == FALSE) {
+			compress_level = 0;
+		}
+
+		value = pe_pref(data_set.config_hash, "pe-input-keyframe-interval");
+		if(value != NULL) {
+			keyframes = crm_parse_int(value, "0");
+			if(keyframes > PE_MAX_KEYFRAME_INTERVAL) {
+				keyframes = PE_MAX_KEYFRAME_INTERVAL;
+			}
+		}
+
+		value = pe_pref(data_set.config_hash, "pe-input-async-write");
+		if(value != NULL) {
+			archive_async = crm_is_true(value);
+		}
+
+		if(series_wrap != 0) {
+			seq = next_sequence(&series[series_id], series_wrap);
+		} else if(series[series_id].next >= 0) {
+			seq = series[series_id].next;
+
+		} else {
+			seq = get_last_sequence(PE_STATE_DIR, series[series_id].name);
+		}
 		
 		data_set.input = NULL;
 		reply = create_reply(msg, data_set.graph);
@@ -168,9 +222,9 @@ process_pe_message(xmlNode *msg, xmlNode *xml_data, IPC_Channel *sender)
 		cleanup_alloc_calculations(&data_set);
 
 		if(series_wrap != 0) {
-		    write_xml_file(xml_data, filename, compress);
-		    write_last_sequence(PE_STATE_DIR, series[series_id].name,
-					seq+1, series_wrap);
+		    pe_archive_input(xml_data, filename, series[series_id].name,
+				     series[series_id].next, compress_level,
+				     keyframes, archive_async);
 		}
 		
 		if(was_processing_error) {
@@ -216,6 +270,7 @@ process_pe_message(xmlNode *msg, xmlNode *xml_data, IPC_Channel *sender)
 		
 	} else if(strcasecmp(op, CRM_OP_QUIT) == 0) {
 		crm_warn("Received quit message, terminating");
+		pe_archive_flush();
 		exit(0);
 	}
 	
@@ -240,6 +295,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 	if(data_set->now == NULL) {
 		data_set->now = new_ha_date(TRUE);
 	}
+	stage_stats_reset();
 
 #if MEMCHECK_STAGE_SETUP
 	check_and_exit(-1);
@@ -247,6 +303,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 	
 	crm_debug_5("unpack constraints");		  
 	stage0(data_set);
+	stage_stats_mark("constraints", data_set);
 	
 #if MEMCHECK_STAGE_0
 	check_and_exit(0);
@@ -267,6 +324,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 
 	crm_debug_5("color resources");
 	stage2(data_set);
+	stage_stats_mark("placement", data_set);
 
 #if MEMCHECK_STAGE_2
 	check_and_exit(2);
@@ -274,6 +332,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 
 	/* unused */
 	stage3(data_set);
+	stage_stats_mark("internal", data_set);
 
 #if MEMCHECK_STAGE_3
 	check_and_exit(3);
@@ -281,6 +340,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 	
 	crm_debug_5("assign nodes to colors");
 	stage4(data_set);	
+	stage_stats_mark("check", data_set);
 	
 #if MEMCHECK_STAGE_4
 	check_and_exit(4);
@@ -288,6 +348,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 
 	crm_debug_5("creating actions and internal ording constraints");
 	stage5(data_set);
+	stage_stats_mark("allocate", data_set);
 
 #if MEMCHECK_STAGE_5
 	check_and_exit(5);
@@ -295,6 +356,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 	
 	crm_debug_5("processing fencing and shutdown cases");
 	stage6(data_set);
+	stage_stats_mark("fencing", data_set);
 	
 #if MEMCHECK_STAGE_6
 	check_and_exit(6);
@@ -302,6 +364,7 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 
 	crm_debug_5("applying ordering constraints");
 	stage7(data_set);
+	stage_stats_mark("ordering", data_set);
 
 #if MEMCHECK_STAGE_7
 	check_and_exit(7);
@@ -309,6 +372,10 @@ do_calculations(pe_working_set_t *data_set, xmlNode *xml_input, ha_time_t *now)
 
 	crm_debug_5("creating transition graph");
 	stage8(data_set);
+	stage_stats_mark("graph", data_set);
+	if(record_stage_stats) {
+		stage_stats_to_graph(data_set->graph);
+	}
 
 #if MEMCHECK_STAGE_8
 	check_and_exit(8);
@@ -120,6 +120,22 @@ struct action_wrapper_s
 		action_t *action;
 };
 
+/* Like slist_iter() but for action->actions_before/actions_after
+ * Edges added while iterating are also visited
+ */
+#define edge_iter(wrapper, edges, counter, a)				\
+	{								\
+		GPtrArray *__crm_edges = edges;				\
+		action_wrapper_t *wrapper = NULL;			\
+		guint counter = 0;					\
+		for(; __crm_edges != NULL && counter < __crm_edges->len; counter++) { \
+			wrapper = g_ptr_array_index(__crm_edges, counter); \
+			{ a; }						\
+		}							\
+	}
+
+#define edge_count(edges) ((edges)?(edges)->len:0)
+
 extern gboolean stage0(pe_working_set_t *data_set);
 extern gboolean probe_resources(pe_working_set_t *data_set);
 extern gboolean stage2(pe_working_set_t *data_set);
@@ -165,7 +181,16 @@ extern int new_rsc_order(resource_t *lh_rsc, const char *lh_task,
 extern void graph_element_from_action(
 	action_t *action, pe_working_set_t *data_set);
 
+/* filename2xml() won't follow more deltas than this */
+#define PE_MAX_KEYFRAME_INTERVAL 100
+
+extern void pe_archive_input(xmlNode *input, const char *filename,
+			     const char *series, int sequence, int level,
+			     int keyframes, gboolean async);
+extern void pe_archive_flush(void);
+
 extern gboolean show_scores;
+extern gboolean record_stage_stats;
 extern int scores_log_level;
 extern const char* transition_idle_timeout;
 
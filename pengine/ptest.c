@@ -27,6 +27,9 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 
 #include <crm/transition.h>
 #include <crm/common/xml.h>
@@ -39,8 +42,10 @@
 #include <pengine.h>
 #include <lib/pengine/utils.h>
 #include <allocate.h>
+#include <utils.h>
 #if HAVE_LIBXML2
 #  include <libxml/parser.h>
+#  include <libxml/xmlmemory.h>
 #endif
 
 gboolean use_stdin = FALSE;
@@ -124,6 +129,7 @@ static struct crm_option long_options[] = {
 
     {"simulate",    0, 0, 'S', "Simulate the transition's execution to find invalid graphs\n"},
     {"show-scores", 0, 0, 's', "Display resource allocation scores"},
+    {"show-stages", 0, 0, 't', "Display the time taken, and objects created, by each stage"},
     {"all-actions", 0, 0, 'a', "Display all possible actions - even ones not part of the transition graph"},
 
     {"live-check",  0, 0, 'L', "Connect to the CIB and use the current contents as input"},
@@ -134,10 +140,400 @@ static struct crm_option long_options[] = {
     {"save-input",  1, 0, 'I', "\tSave the input to the named file"},
     {"save-graph",  1, 0, 'G', "\tSave the transition graph (XML format) to the named file"},
     {"save-dotfile",1, 0, 'D', "Save the transition graph (DOT format) to the named file\n"},
+
+    {"previous",    1, 0, 'P', "\tProcess the named file first, as the pengine daemon would have"},
+    {"save-series", 1, 0, 'A', "Save every input, as the pengine daemon would with keyframes, to the named directory\n"},
+
+    {"benchmark",   1, 0, 'b', "\tRepeat the calculation N times and report how long it took (later runs find the caches warm)"},
+    {"benchmark-dir",1, 0, 'B', "Benchmark every input (*.xml, *.bz2) in the named directory\n"},
     
     {0, 0, 0, 0}
 };
 
+#define BENCH_DEFAULT_RUNS 10
+#define BENCH_MAX_STAGES 16
+
+static unsigned long glib_allocs = 0;
+static unsigned long xml_allocs = 0;
+
+static gpointer
+count_g_malloc(gsize n_bytes)
+{
+	glib_allocs++;
+	return malloc(n_bytes);
+}
+
+static gpointer
+count_g_calloc(gsize n_blocks, gsize n_block_bytes)
+{
+	glib_allocs++;
+	return calloc(n_blocks, n_block_bytes);
+}
+
+static gpointer
+count_g_realloc(gpointer mem, gsize n_bytes)
+{
+	if(mem == NULL) {
+		glib_allocs++;
+	}
+	return realloc(mem, n_bytes);
+}
+
+#if HAVE_LIBXML2
+static void *
+count_xml_malloc(size_t size)
+{
+	xml_allocs++;
+	return malloc(size);
+}
+
+static void *
+count_xml_realloc(void *mem, size_t size)
+{
+	if(mem == NULL) {
+		xml_allocs++;
+	}
+	return realloc(mem, size);
+}
+
+static char *
+count_xml_strdup(const char *str)
+{
+	xml_allocs++;
+	return strdup(str);
+}
+#endif
+
+static int
+compare_elapsed(const void *a, const void *b)
+{
+	double lhs = *(const double*)a;
+	double rhs = *(const double*)b;
+
+	if(lhs < rhs) {
+		return -1;
+	} else if(lhs > rhs) {
+		return 1;
+	}
+	return 0;
+}
+
+/* Run do_calculations() on fresh copies of cib_object and print
+ * the distribution of the wall-clock times
+ *
+ * The process-wide caches (operation digests and the saved legacy
+ * configuration) are kept between runs, as they are by the daemon, so
+ * only the first run is a cold start.  It is also reported separately.
+ *
+ * Only glib's and libxml2's allocators can be hooked.  Objects the PE
+ * allocates with crm_malloc0() and friends go straight to malloc() and
+ * are not counted.
+ */
+static void
+benchmark_input(const char *source, xmlNode *cib_object, int runs)
+{
+	int lpc = 0;
+	int stage = 0;
+	int num_stages = 0;
+	double first = 0;
+	double median = 0;
+	double total = 0;
+	double *elapsed = NULL;
+	double stage_ms[BENCH_MAX_STAGES];
+	const char *stage_names[BENCH_MAX_STAGES];
+	unsigned long run_glib_allocs = 0;
+	unsigned long run_xml_allocs = 0;
+	struct rusage usage;
+
+	crm_malloc0(elapsed, runs * sizeof(double));
+	memset(stage_ms, 0, sizeof(stage_ms));
+
+	for(lpc = 0; lpc < runs; lpc++) {
+		double ms = 0;
+		unsigned long glib_start = 0;
+		unsigned long xml_start = 0;
+		const char *name = NULL;
+		ha_time_t *a_date = NULL;
+		pe_working_set_t data_set;
+		struct timeval start, end;
+		xmlNode *input = copy_xml(cib_object);
+
+		if(use_date != NULL) {
+			char *date_s = use_date;
+			a_date = parse_date(&date_s);
+		}
+
+		glib_start = glib_allocs;
+		xml_start = xml_allocs;
+		gettimeofday(&start, NULL);
+
+		do_calculations(&data_set, input, a_date);
+
+		gettimeofday(&end, NULL);
+		run_glib_allocs += glib_allocs - glib_start;
+		run_xml_allocs += xml_allocs - xml_start;
+
+		elapsed[lpc] = (end.tv_sec - start.tv_sec) * 1000.0
+			+ (end.tv_usec - start.tv_usec) / 1000.0;
+		total += elapsed[lpc];
+
+		for(stage = 0; stage < BENCH_MAX_STAGES
+			    && stage_stats_get(stage, &name, &ms); stage++) {
+			stage_names[stage] = name;
+			stage_ms[stage] += ms;
+		}
+		num_stages = stage;
+
+		cleanup_alloc_calculations(&data_set);
+	}
+
+	first = elapsed[0];
+	qsort(elapsed, runs, sizeof(double), compare_elapsed);
+	median = elapsed[runs/2];
+	if(runs % 2 == 0) {
+		median = (elapsed[runs/2 - 1] + elapsed[runs/2]) / 2;
+	}
+
+	fprintf(stdout, "%s: %d runs\n", source, runs);
+	fprintf(stdout, "  %-12s first=%.3f min=%.3f median=%.3f p99=%.3f max=%.3f mean=%.3f\n",
+		"ms", first, elapsed[0], median, elapsed[(99 * runs + 99) / 100 - 1],
+		elapsed[runs - 1], total / runs);
+	for(stage = 0; stage < num_stages; stage++) {
+		fprintf(stdout, "  %-12s mean=%.3f\n",
+			stage_names[stage], stage_ms[stage] / runs);
+	}
+	fprintf(stdout, "  %-12s glib=%lu libxml2=%lu (per run, excluding crm_malloc0())\n",
+		"allocations", run_glib_allocs / runs, run_xml_allocs / runs);
+	if(getrusage(RUSAGE_SELF, &usage) == 0) {
+		fprintf(stdout, "  %-12s %ldkB (so far)\n",
+			"peak-rss", usage.ru_maxrss);
+	}
+	fflush(stdout);
+
+	crm_free(elapsed);
+}
+
+static xmlNode *
+load_benchmark_input(const char *xml_file)
+{
+	xmlNode *cib_object = filename2xml(xml_file);
+
+	if(cib_object == NULL) {
+		fprintf(stderr, "Could not parse configuration input from: %s\n", xml_file);
+
+	} else if(cli_config_update(&cib_object, NULL, FALSE) == FALSE) {
+		fprintf(stderr, "Could not upgrade %s\n", xml_file);
+		free_xml(cib_object);
+		cib_object = NULL;
+
+	} else if(validate_xml(cib_object, NULL, FALSE) != TRUE) {
+		fprintf(stderr, "%s does not validate\n", xml_file);
+		free_xml(cib_object);
+		cib_object = NULL;
+	}
+	return cib_object;
+}
+
+static const char *series_dir = NULL;
+static int series_sequence = 0;
+
+/* Archive the input under its own name, the first in full and the rest
+ * as deltas, so that reading them back can be checked
+ */
+static void
+save_series_input(xmlNode *input, const char *xml_file)
+{
+	char *filename = NULL;
+	xmlNode *copy = NULL;
+	const char *name = strrchr(xml_file, '/');
+
+	if(series_dir == NULL) {
+		return;
+	}
+
+	name = name?name+1:xml_file;
+	filename = crm_concat(series_dir, name, '/');
+	copy = copy_xml(input);
+
+	pe_archive_input(copy, filename, "ptest-series", ++series_sequence,
+			 0, PE_MAX_KEYFRAME_INTERVAL, FALSE);
+
+	free_xml(copy);
+	crm_free(filename);
+}
+
+/* Let the PE see the named input first, as the daemon would have */
+static gboolean
+process_previous(const char *xml_file)
+{
+	pe_working_set_t data_set;
+	ha_time_t *a_date = NULL;
+	gboolean scores = show_scores;
+	xmlNode *cib_object = filename2xml(xml_file);
+
+	if(cib_object == NULL) {
+		fprintf(stderr, "Could not parse the previous input from: %s\n", xml_file);
+		return FALSE;
+	}
+
+	save_series_input(cib_object, xml_file);
+	if(cli_config_update(&cib_object, NULL, FALSE) == FALSE) {
+		fprintf(stderr, "Could not upgrade %s\n", xml_file);
+		free_xml(cib_object);
+		return FALSE;
+	}
+
+	if(use_date != NULL) {
+		char *date_s = use_date;
+		a_date = parse_date(&date_s);
+	}
+
+	/* only the scores for the real input are wanted */
+	show_scores = FALSE;
+	do_calculations(&data_set, cib_object, a_date);
+	show_scores = scores;
+
+	cleanup_alloc_calculations(&data_set);
+	return TRUE;
+}
+
+static gboolean
+same_graph_input(synapse_t *synapse, crm_action_t *compact, crm_action_t *full)
+{
+	int lpc = 0;
+	const char *attrs[] = {
+		XML_LRM_ATTR_TASK_KEY,
+		XML_LRM_ATTR_TARGET,
+	};
+
+	if(compact->id != full->id || compact->type != full->type) {
+		crm_err("Synapse %d: input %d (type %d) should be %d (type %d)",
+			synapse->id, compact->id, compact->type, full->id, full->type);
+		return FALSE;
+	}
+	for(lpc = 0; lpc < DIMOF(attrs); lpc++) {
+		const char *value = crm_element_value(compact->xml, attrs[lpc]);
+		const char *expected = crm_element_value(full->xml, attrs[lpc]);
+		if(safe_str_neq(value, expected)) {
+			crm_err("Synapse %d: input %d has %s=%s instead of %s",
+				synapse->id, compact->id, attrs[lpc],
+				crm_str(value), crm_str(expected));
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* Recalculate with compact-transition-graph=false and check the TE
+ * sees the same synapse inputs in both forms of the graph
+ */
+static gboolean
+check_compact_graph(xmlNode *input, crm_graph_t *compact)
+{
+	int lpc = 0;
+	gboolean same = TRUE;
+	gboolean scores = show_scores;
+	pe_working_set_t data_set;
+	ha_time_t *a_date = NULL;
+	crm_graph_t *full = NULL;
+	GListPtr full_synapses = NULL;
+	xmlNode *full_input = copy_xml(input);
+	xmlXPathObjectPtr xpathObj = xpath_search(
+		full_input, "//"XML_CIB_TAG_NVPAIR"[@name='compact-transition-graph']");
+
+	if(xpathObj != NULL && xpathObj->nodesetval != NULL) {
+		for(lpc = 0; lpc < xpathObj->nodesetval->nodeNr; lpc++) {
+			xmlNode *match = getXpathResult(xpathObj, lpc);
+			crm_xml_add(match, XML_NVPAIR_ATTR_VALUE, XML_BOOLEAN_FALSE);
+		}
+	}
+	if(xpathObj) {
+		xmlXPathFreeObject(xpathObj);
+	}
+
+	if(use_date != NULL) {
+		char *date_s = use_date;
+		a_date = parse_date(&date_s);
+	}
+
+	show_scores = FALSE;
+	do_calculations(&data_set, full_input, a_date);
+	show_scores = scores;
+	full = unpack_graph(data_set.graph, "ptest");
+
+	if(g_list_length(compact->synapses) != g_list_length(full->synapses)) {
+		crm_err("The compact graph has %d synapses instead of %d",
+			g_list_length(compact->synapses), g_list_length(full->synapses));
+		same = FALSE;
+		goto done;
+	}
+
+	full_synapses = full->synapses;
+	slist_iter(
+		synapse, synapse_t, compact->synapses, lpc1,
+		synapse_t *full_synapse = full_synapses->data;
+		GListPtr full_inputs = full_synapse->inputs;
+
+		full_synapses = full_synapses->next;
+		if(g_list_length(synapse->inputs) != g_list_length(full_inputs)) {
+			crm_err("Synapse %d has %d inputs instead of %d", synapse->id,
+				g_list_length(synapse->inputs), g_list_length(full_inputs));
+			same = FALSE;
+			continue;
+		}
+		
+		slist_iter(
+			input, crm_action_t, synapse->inputs, lpc2,
+			if(same_graph_input(synapse, input, full_inputs->data) == FALSE) {
+				same = FALSE;
+			}
+			full_inputs = full_inputs->next;
+			);
+		);
+
+  done:
+	destroy_graph(full);
+	cleanup_alloc_calculations(&data_set);
+	return same;
+}
+
+static int
+benchmark_input_file(const struct dirent *entry)
+{
+	const char *suffix = strrchr(entry->d_name, '.');
+	return safe_str_eq(suffix, ".xml") || safe_str_eq(suffix, ".bz2");
+}
+
+static int
+benchmark_dir(const char *dir, int runs)
+{
+	int lpc = 0;
+	int rc = 0;
+	struct dirent **namelist = NULL;
+	int file_num = scandir(dir, &namelist, benchmark_input_file, alphasort);
+
+	if(file_num < 0) {
+		crm_perror(LOG_ERR, "Could not scan %s", dir);
+		return 4;
+	}
+
+	for(lpc = 0; lpc < file_num; lpc++) {
+		char *xml_file = crm_concat(dir, namelist[lpc]->d_name, '/');
+		xmlNode *cib_object = load_benchmark_input(xml_file);
+
+		if(cib_object != NULL) {
+			benchmark_input(xml_file, cib_object, runs);
+			free_xml(cib_object);
+		} else {
+			rc = 4;
+		}
+		crm_free(xml_file);
+		free(namelist[lpc]);
+	}
+	free(namelist);
+	return rc;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -162,21 +558,24 @@ main(int argc, char **argv)
 	const char *graph_file = NULL;
 	const char *input_file = NULL;
 	const char *input_xml = NULL;
+	const char *bench_dir = NULL;
+	GListPtr previous_files = NULL;
+	int bench_runs = 0;
 
 	/* disable glib's fancy allocators that can't be free'd */ 
 	GMemVTable vtable;
 
-	vtable.malloc = malloc;
-	vtable.realloc = realloc;
+	vtable.malloc = count_g_malloc;
+	vtable.realloc = count_g_realloc;
 	vtable.free = free;
-	vtable.calloc = calloc;
-	vtable.try_malloc = malloc;	
-	vtable.try_realloc = realloc;
+	vtable.calloc = count_g_calloc;
+	vtable.try_malloc = count_g_malloc;	
+	vtable.try_realloc = count_g_realloc;
 
         g_mem_set_vtable(&vtable);
 
 	crm_log_init("ptest", LOG_CRIT, FALSE, FALSE, 0, NULL);
-	crm_set_options("V?$XD:G:I:Lwx:d:aSs", "[-?Vv] -[Xxp] {other options}", long_options,
+	crm_set_options("V?$XD:G:I:Lwx:d:aSstb:B:P:A:", "[-?Vv] -[Xxp] {other options}", long_options,
 			"Calculate the cluster's response to the supplied cluster state\n");
 	
 	while (1) {
@@ -202,6 +601,9 @@ main(int argc, char **argv)
 			case 's':
 				show_scores = TRUE;
 				break;
+			case 't':
+				record_stage_stats = TRUE;
+				break;
 			case 'x':
 				xml_file = optarg;
 				break;
@@ -224,6 +626,18 @@ main(int argc, char **argv)
 			case 'L':
 				USE_LIVE_CIB = TRUE;
 				break;
+			case 'b':
+				bench_runs = crm_parse_int(optarg, "0");
+				break;
+			case 'B':
+				bench_dir = optarg;
+				break;
+			case 'P':
+				previous_files = g_list_append(previous_files, optarg);
+				break;
+			case 'A':
+				series_dir = optarg;
+				break;
 			case '$':
 			case '?':
 				crm_help(flag, 0);
@@ -251,6 +665,20 @@ main(int argc, char **argv)
 		crm_err("%d errors in option parsing", argerr);
 		crm_help('?', 1);
 	}
+
+#if HAVE_LIBXML2
+	if(bench_runs > 0 || bench_dir != NULL) {
+		/* count libxml2's allocations too */
+		xmlMemSetup(free, count_xml_malloc, count_xml_realloc, count_xml_strdup);
+	}
+#endif
+
+	if(bench_dir != NULL) {
+		int rc = benchmark_dir(
+			bench_dir, bench_runs > 0?bench_runs:BENCH_DEFAULT_RUNS);
+		crm_log_deinit();
+		return rc;
+	}
   
 	if(USE_LIVE_CIB) {
 		int rc = cib_ok;
@@ -293,6 +721,18 @@ main(int argc, char **argv)
 	    crm_help('?', 1);
 	}
 	
+	slist_iter(previous_file, const char, previous_files, lpc,
+		   if(process_previous(previous_file) == FALSE) {
+			   free_xml(cib_object);
+			   return 4;
+		   }
+	    );
+
+	if(xml_file != NULL) {
+	    save_series_input(cib_object, xml_file);
+	}
+
+	g_list_free(previous_files);
 	if(cli_config_update(&cib_object, NULL, FALSE) == FALSE) {
 	    free_xml(cib_object);
 	    return cib_STALE;
@@ -303,6 +743,13 @@ main(int argc, char **argv)
 	    return cib_dtd_validation;
 	}
 	
+	if(bench_runs > 0) {
+		benchmark_input(source, cib_object, bench_runs);
+		free_xml(cib_object);
+		crm_log_deinit();
+		return 0;
+	}
+	
 	if(input_file != NULL) {
 		FILE *input_strm = fopen(input_file, "w");
 		if(input_strm == NULL) {
@@ -332,6 +779,15 @@ main(int argc, char **argv)
 	    }
 	    do_calculations(&data_set, cib_object, a_date);
 	}
+
+	if(record_stage_stats) {
+	    fprintf(stdout, "Stage statistics:\n");
+	    xml_prop_iter(data_set.graph, name, value,
+			  if(strstr(name, "stats-") == name) {
+			      fprintf(stdout, "  %-12s %s\n", name+6, value);
+			  }
+		);
+	}
 	
 	msg_buffer = dump_xml_formatted(data_set.graph);
 	if(safe_str_eq(graph_file, "-")) {
@@ -410,8 +866,8 @@ main(int argc, char **argv)
 
 	slist_iter(
 		action, action_t, data_set.actions, lpc,
-		slist_iter(
-			before, action_wrapper_t, action->actions_before, lpc2,
+		edge_iter(
+			before, action->actions_before, lpc2,
 			char *before_name = NULL;
 			char *after_name = NULL;
 			const char *style = "dashed";
@@ -455,6 +911,12 @@ main(int argc, char **argv)
 	transition = unpack_graph(data_set.graph, "ptest");
 	print_graph(LOG_DEBUG, transition);
 
+	if(is_set(data_set.flags, pe_flag_compact_graph)
+	   && check_compact_graph(data_set.input, transition) == FALSE) {
+		crm_err("The compact graph differs from the full one");
+		all_good = FALSE;
+	}
+
 	do {
 		graph_rc = run_graph(transition);
 		
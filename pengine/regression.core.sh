@@ -245,6 +245,45 @@ function do_test {
     num_failed=`expr $num_failed + $did_fail`
 }
 
+# do_delta_test description test... : save the tests' inputs as the
+# pengine would with keyframes, ie. the first in full and the rest as
+# deltas, and check that each reads back with the same results
+function do_delta_test {
+    delta_desc=$1; shift
+    delta_dir=$test_home/.regression.deltas
+    saved_io_dir=$io_dir
+    previous=""
+    last=""
+
+    rm -rf $delta_dir
+    mkdir -p $delta_dir
+    for delta_test in $*; do
+	if [ "x$last" != "x" ]; then
+	    previous="$previous -P $io_dir/$last.xml"
+	fi
+	last=$delta_test
+	cp $io_dir/$delta_test.exp $io_dir/$delta_test.dot $io_dir/$delta_test.scores $delta_dir
+    done
+
+    $test_cmd -A $delta_dir $previous -x $io_dir/$last.xml > /dev/null 2> $delta_dir/stderr
+    if [ -s $delta_dir/stderr ]; then
+	error "Output was written to stderr while saving the inputs"
+	cat $delta_dir/stderr
+	num_failed=`expr $num_failed + 1`
+    fi
+
+    io_dir=$delta_dir
+    for delta_test in $*; do
+	do_test $delta_test "$delta_desc"
+	if [ $delta_test != $1 ] && ! grep -q "<pe_input_delta" $delta_dir/$delta_test.xml; then
+	    failed "Input was not saved as a delta"
+	    num_failed=`expr $num_failed + 1`
+	fi
+    done
+    io_dir=$saved_io_dir
+    rm -rf $delta_dir
+}
+
 function test_results {
     if [ $num_failed != 0 ]; then
 	if [ -s $failed ]; then
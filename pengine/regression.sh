@@ -331,6 +331,7 @@ do_test stonith-0 "Stonith loop - 1"
 do_test stonith-1 "Stonith loop - 2"
 do_test stonith-2 "Stonith loop - 3"
 do_test stonith-3 "Stonith startup"
+do_test compact-graph-1 "Stonith loop - 2 (synapse inputs by id)"
 do_test bug-1572-1 "Recovery of groups depending on master/slave"
 do_test bug-1572-2 "Recovery of groups depending on master/slave when the master is never re-promoted"
 do_test bug-1685 "Depends-on-master ordering"
@@ -381,6 +382,9 @@ do_test systemhealthp1 "System Health (Progessive)     #1"
 do_test systemhealthp2 "System Health (Progessive)     #2"
 do_test systemhealthp3 "System Health (Progessive)     #3"
 
+echo ""
+do_delta_test "System Health (Progessive) saved as deltas" systemhealthp1 systemhealthp2 systemhealthp3
+
 echo ""
 
 test_results
@@ -21,6 +21,7 @@
 #include <allocate.h>
 #include <utils.h>
 #include <lib/pengine/utils.h>
+#include <sys/time.h>
 
 void
 print_rsc_to_node(const char *pre_text, rsc_to_node_t *cons, gboolean details)
@@ -82,7 +83,6 @@ pe_free_ordering(GListPtr constraints)
 
 		crm_free(order->lh_action_task);
 		crm_free(order->rh_action_task);
-		crm_free(order);
 	}
 	if(constraints != NULL) {
 		g_list_free(constraints);
@@ -99,7 +99,6 @@ pe_free_rsc_to_node(GListPtr constraints)
 		iterator = iterator->next;
 
 		pe_free_shallow(cons->node_list_rh);
-		crm_free(cons);
 	}
 	if(constraints != NULL) {
 		g_list_free(constraints);
@@ -107,6 +106,26 @@ pe_free_rsc_to_node(GListPtr constraints)
 }
 
 
+/* g_list_append() without walking the list
+ *
+ * Every constraint used to be appended by walking the whole list, which
+ * made unpacking large configurations quadratic.  The order of the list
+ * (and so of constraint processing) is unchanged.
+ */
+GListPtr
+constraint_append(GListPtr list, GListPtr *tail, gpointer data)
+{
+	if(list == NULL || *tail == NULL) {
+		list = g_list_append(list, data);
+		*tail = g_list_last(list);
+
+	} else {
+		g_list_append(*tail, data);
+		*tail = (*tail)->next;
+	}
+	return list;
+}
+
 rsc_to_node_t *
 rsc2node_new(const char *id, resource_t *rsc,
 	     int node_weight, node_t *foo_node, pe_working_set_t *data_set)
@@ -121,7 +140,7 @@ rsc2node_new(const char *id, resource_t *rsc,
 		CRM_CHECK(node_weight == 0, return NULL);
 	}
 	
-	crm_malloc0(new_con, sizeof(rsc_to_node_t));
+	new_con = pe_arena_alloc(data_set, sizeof(rsc_to_node_t));
 	if(new_con != NULL) {
 		new_con->id           = id;
 		new_con->rsc_lh       = rsc;
@@ -134,8 +153,9 @@ rsc2node_new(const char *id, resource_t *rsc,
 			new_con->node_list_rh = g_list_append(NULL, copy);
 		}
 		
-		data_set->placement_constraints = g_list_append(
-			data_set->placement_constraints, new_con);
+		data_set->placement_constraints = constraint_append(
+			data_set->placement_constraints,
+			&data_set->placement_tail, new_con);
 		rsc->rsc_location = g_list_append(rsc->rsc_location, new_con);
 	}
 	
@@ -265,6 +285,7 @@ native_assign_node(resource_t *rsc, GListPtr nodes, node_t *chosen, gboolean for
 	CRM_ASSERT(rsc->variant == pe_native);
 
 	clear_bit(rsc->flags, pe_rsc_provisional);
+	rsc_merge_weights_cache_flush();
 	
 	if(force == FALSE
 	   && chosen != NULL
@@ -297,7 +318,7 @@ native_assign_node(resource_t *rsc, GListPtr nodes, node_t *chosen, gboolean for
 	    rsc->next_role = RSC_ROLE_STOPPED;
 	    
 	    key = generate_op_key(rsc->id, CRMD_ACTION_STOP, 0);
-	    possible_matches = find_actions(rsc->actions, key, NULL);
+	    possible_matches = find_actions(rsc->action_index, key, NULL);
 
 	    slist_iter(
 		stop, action_t, possible_matches, lpc,
@@ -308,7 +329,7 @@ native_assign_node(resource_t *rsc, GListPtr nodes, node_t *chosen, gboolean for
 	    crm_free(key);
 
 	    key = generate_op_key(rsc->id, CRMD_ACTION_START, 0);
-	    possible_matches = find_actions(rsc->actions, key, NULL);
+	    possible_matches = find_actions(rsc->action_index, key, NULL);
 
 	    slist_iter(
 		start, action_t, possible_matches, lpc,
@@ -408,12 +429,53 @@ convert_non_atomic_task(char *old_uuid, resource_t *rsc, gboolean allow_notify,
 }
 
 
+typedef struct action_edge_s 
+{
+		action_t *first;
+		action_t *then;
+		enum pe_ordering type;
+} action_edge_t;
+
+static guint
+action_edge_hash(gconstpointer key)
+{
+	const action_edge_t *edge = key;
+	guint hash = GPOINTER_TO_UINT(edge->first);
+	hash = (hash << 5) + hash + GPOINTER_TO_UINT(edge->then);
+	hash = (hash << 5) + hash + edge->type;
+	return hash;
+}
+
+static gboolean
+action_edge_equal(gconstpointer a, gconstpointer b)
+{
+	const action_edge_t *edge_a = a;
+	const action_edge_t *edge_b = b;
+	return edge_a->first == edge_b->first
+		&& edge_a->then == edge_b->then
+		&& edge_a->type == edge_b->type;
+}
+
+static void
+add_edge(GPtrArray **edges, action_t *action, enum pe_ordering order) 
+{
+	action_wrapper_t *wrapper = pe_arena_alloc(pe_dataset, sizeof(action_wrapper_t));
+	wrapper->action = action;
+	wrapper->type = order;
+
+	if(*edges == NULL) {
+		*edges = g_ptr_array_new();
+	}
+	g_ptr_array_add(*edges, wrapper);
+}
+
 void
 order_actions(
 	action_t *lh_action, action_t *rh_action, enum pe_ordering order) 
 {
-	action_wrapper_t *wrapper = NULL;
-	GListPtr list = NULL;
+	action_edge_t lookup;
+	action_edge_t *edge = NULL;
+	action_wrapper_t *existing = NULL;
 	
 	crm_debug_3("Ordering Action %s before %s",
 		    lh_action->uuid, rh_action->uuid);
@@ -421,26 +483,41 @@ order_actions(
 	log_action(LOG_DEBUG_4, "LH (order_actions)", lh_action, FALSE);
 	log_action(LOG_DEBUG_4, "RH (order_actions)", rh_action, FALSE);
 
+	/* Identical edges add nothing and would only be filtered
+	 * out again when the graph is created
+	 */
+	if(pe_dataset->action_edges == NULL) {
+		pe_dataset->action_edges = g_hash_table_new(
+			action_edge_hash, action_edge_equal);
+	}
+
+	lookup.first = lh_action;
+	lookup.then = rh_action;
+	lookup.type = order;
+	existing = g_hash_table_lookup(pe_dataset->action_edges, &lookup);
 	
-	crm_malloc0(wrapper, sizeof(action_wrapper_t));
-	wrapper->action = rh_action;
-	wrapper->type = order;
+	if(existing != NULL && existing->type == order) {
+		crm_debug_4("%s before %s (0x%.6x) already exists",
+			    lh_action->uuid, rh_action->uuid, order);
+		return;
+	}
 	
-	list = lh_action->actions_after;
-	list = g_list_append(list, wrapper);
-	lh_action->actions_after = list;
-
-	wrapper = NULL;
+	add_edge(&(lh_action->actions_after), rh_action, order);
 
 /* 	order |= pe_order_implies_right; */
 /* 	order ^= pe_order_implies_right; */
 	
-	crm_malloc0(wrapper, sizeof(action_wrapper_t));
-	wrapper->action = lh_action;
-	wrapper->type = order;
-	list = rh_action->actions_before;
-	list = g_list_append(list, wrapper);
-	rh_action->actions_before = list;
+	add_edge(&(rh_action->actions_before), lh_action, order);
+
+	/* Remember the 'before' wrapper, it's the one that gets
+	 * disabled (type = pe_order_none) when an ordering is broken
+	 */
+	edge = pe_arena_alloc(pe_dataset, sizeof(action_edge_t));
+	*edge = lookup;
+	g_hash_table_replace(
+		pe_dataset->action_edges, edge,
+		g_ptr_array_index(rh_action->actions_before,
+				  rh_action->actions_before->len - 1));
 }
 
 
@@ -505,13 +582,13 @@ log_action(unsigned int log_level, const char *pre_text, action_t *action, gbool
 
 	if(details) {
 		do_crm_log_unlikely(log_level+1, "\t\t====== Preceding Actions");
-		slist_iter(
-			other, action_wrapper_t, action->actions_before, lpc,
+		edge_iter(
+			other, action->actions_before, lpc,
 			log_action(log_level+1, "\t\t", other->action, FALSE);
 			);
 		do_crm_log_unlikely(log_level+1, "\t\t====== Subsequent Actions");
-		slist_iter(
-			other, action_wrapper_t, action->actions_after, lpc,
+		edge_iter(
+			other, action->actions_after, lpc,
 			log_action(log_level+1, "\t\t", other->action, FALSE);
 			);		
 		do_crm_log_unlikely(log_level+1, "\t\t====== End");
@@ -519,8 +596,8 @@ log_action(unsigned int log_level, const char *pre_text, action_t *action, gbool
 	} else {
 		do_crm_log_unlikely(log_level, "\t\t(seen=%d, before=%d, after=%d)",
 			      action->seen_count,
-			      g_list_length(action->actions_before),
-			      g_list_length(action->actions_after));
+			      edge_count(action->actions_before),
+			      edge_count(action->actions_after));
 	}
 }
 
@@ -530,7 +607,7 @@ action_t *get_pseudo_op(const char *name, pe_working_set_t *data_set)
     const char *op_s = name;
     GListPtr possible_matches = NULL;
 
-    possible_matches = find_actions(data_set->actions, name, NULL);
+    possible_matches = find_actions(data_set->action_index, name, NULL);
     if(possible_matches != NULL) {
 	if(g_list_length(possible_matches) > 1) {
 	    pe_warn("Action %s exists %d times",
@@ -583,3 +660,105 @@ minimum_resource_state(resource_t *rsc, gboolean current)
     }
     return rsc->fns->state(rsc, current);
 }
+
+#define MAX_STAGE_STATS 16
+
+typedef struct stage_stats_s 
+{
+	const char *name;
+	unsigned long elapsed_us;
+	int actions;
+	int constraints;
+	int edges;
+} stage_stats_t;
+
+static stage_stats_t stage_stats[MAX_STAGE_STATS];
+static stage_stats_t stage_totals;
+static struct timeval stage_start;
+static int num_stage_stats = 0;
+
+static void
+count_stage_totals(stage_stats_t *totals, pe_working_set_t *data_set)
+{
+	totals->actions = data_set->action_id;
+	totals->constraints = g_list_length(data_set->placement_constraints)
+		+ g_list_length(data_set->ordering_constraints)
+		+ g_list_length(data_set->colocation_constraints);
+	totals->edges = 0;
+	if(data_set->action_edges != NULL) {
+		totals->edges = g_hash_table_size(data_set->action_edges);
+	}
+}
+
+void
+stage_stats_reset(void)
+{
+	num_stage_stats = 0;
+	memset(&stage_totals, 0, sizeof(stage_stats_t));
+	gettimeofday(&stage_start, NULL);
+}
+
+/* Close the current stage, charging it with the time and objects
+ * accumulated since the previous call
+ */
+void
+stage_stats_mark(const char *stage, pe_working_set_t *data_set)
+{
+	stage_stats_t now;
+	stage_stats_t *stats = NULL;
+	struct timeval stage_end;
+
+	gettimeofday(&stage_end, NULL);
+
+	CRM_CHECK(num_stage_stats < MAX_STAGE_STATS, return);
+	count_stage_totals(&now, data_set);
+	
+	stats = &(stage_stats[num_stage_stats++]);
+	stats->name = stage;
+	stats->elapsed_us = (stage_end.tv_sec - stage_start.tv_sec) * 1000000
+		+ stage_end.tv_usec - stage_start.tv_usec;
+	stats->actions = now.actions - stage_totals.actions;
+	stats->constraints = now.constraints - stage_totals.constraints;
+	stats->edges = now.edges - stage_totals.edges;
+
+	crm_debug_2("Stage %s: %lu.%03lums, %d actions, %d constraints, %d edges",
+		    stats->name, stats->elapsed_us / 1000, stats->elapsed_us % 1000,
+		    stats->actions, stats->constraints, stats->edges);
+
+	stage_totals = now;
+	stage_start = stage_end;
+}
+
+/* Look up the index'th stage recorded by the last do_calculations() */
+gboolean
+stage_stats_get(int index, const char **stage, double *elapsed_ms)
+{
+	if(index < 0 || index >= num_stage_stats) {
+		return FALSE;
+	}
+	*stage = stage_stats[index].name;
+	*elapsed_ms = stage_stats[index].elapsed_us / 1000.0;
+	return TRUE;
+}
+
+void
+stage_stats_to_graph(xmlNode *graph)
+{
+	int lpc = 0;
+	char *name = NULL;
+	char value[128];
+
+	CRM_CHECK(graph != NULL, return);
+	for(lpc = 0; lpc < num_stage_stats; lpc++) {
+		stage_stats_t *stats = &(stage_stats[lpc]);
+
+		name = crm_concat("stats", stats->name, '-');
+		snprintf(value, sizeof(value),
+			 "ms=%lu.%03lu actions=%d constraints=%d edges=%d",
+			 stats->elapsed_us / 1000, stats->elapsed_us % 1000,
+			 stats->actions, stats->constraints, stats->edges);
+
+		crm_xml_add(graph, name, value);
+		crm_free(name);
+	}
+}
@@ -33,6 +33,7 @@ extern rsc_to_node_t *rsc2node_new(
 	const char *id, resource_t *rsc, int weight, node_t *node,
 	pe_working_set_t *data_set);
 
+extern GListPtr constraint_append(GListPtr list, GListPtr *tail, gpointer data);
 extern void pe_free_rsc_to_node(GListPtr constraints);
 extern void pe_free_ordering(GListPtr constraints);
 
@@ -65,6 +66,12 @@ extern resource_t *find_compatible_child(
 
 extern enum rsc_role_e minimum_resource_state(resource_t *rsc, gboolean current);
 
+extern void stage_stats_reset(void);
+extern void stage_stats_mark(const char *stage, pe_working_set_t *data_set);
+extern void stage_stats_to_graph(xmlNode *graph);
+extern gboolean stage_stats_get(
+	int index, const char **stage, double *elapsed_ms);
+
 #define STONITH_UP "stonith_up"
 #define STONITH_DONE "stonith_complete"
 #define ALL_STOPPED "all_stopped"
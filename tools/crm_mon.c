@@ -664,7 +664,7 @@ static void print_rsc_history(pe_working_set_t *data_set, node_t *node, xmlNode
     gboolean print_name = TRUE;
     GListPtr sorted_op_list = NULL;
     const char *rsc_id = crm_element_value(rsc_entry, XML_ATTR_ID);
-    resource_t *rsc = pe_find_resource(data_set->resources, rsc_id);
+    resource_t *rsc = pe_lookup_resource(data_set, rsc_id);
 
     xml_child_iter_filter(
 	rsc_entry, rsc_op, XML_LRM_TAG_RSC_OP,
@@ -883,7 +883,7 @@ static void print_node_summary(pe_working_set_t *data_set, gboolean operations)
 
 	    } else {
 		const char *rsc_id = crm_element_value(rsc_entry, XML_ATTR_ID);
-		resource_t *rsc = pe_find_resource(data_set->resources, rsc_id);
+		resource_t *rsc = pe_lookup_resource(data_set, rsc_id);
 		if(rsc) {
 		    print_rsc_summary(data_set, node, rsc, FALSE);
 		} else {
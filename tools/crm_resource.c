@@ -148,7 +148,7 @@ do_find_resource(const char *rsc, resource_t *the_rsc, pe_working_set_t *data_se
 	int found = 0;
 
 	if(the_rsc == NULL) {
-		the_rsc = pe_find_resource(data_set->resources, rsc);
+		the_rsc = pe_lookup_resource(data_set, rsc);
     	}
 
 	if(the_rsc == NULL) {
@@ -305,10 +305,10 @@ do_find_resource_list(pe_working_set_t *data_set, gboolean raw)
 
 static resource_t *find_rsc_or_clone(const char *rsc, pe_working_set_t *data_set) 
 {
-    resource_t *the_rsc = pe_find_resource(data_set->resources, rsc);
+    resource_t *the_rsc = pe_lookup_resource(data_set, rsc);
     if(the_rsc == NULL) {
 	char *as_clone = crm_concat(rsc, "0", ':');
-	the_rsc = pe_find_resource(data_set->resources, as_clone);
+	the_rsc = pe_lookup_resource(data_set, as_clone);
 	crm_free(as_clone);
     }
     return the_rsc;
@@ -595,7 +595,7 @@ dump_resource_prop(
 	const char *rsc, const char *attr, pe_working_set_t *data_set)
 {
 	const char *value = NULL;
-	resource_t *the_rsc = pe_find_resource(data_set->resources, rsc);
+	resource_t *the_rsc = pe_lookup_resource(data_set, rsc);
 
 	if(the_rsc == NULL) {
 		return cib_NOTEXISTS;
@@ -622,7 +622,7 @@ send_lrm_rsc_op(IPC_Channel *crmd_channel, const char *op,
 	const char *value = NULL;
 	xmlNode *params = NULL;
 	xmlNode *msg_data = NULL;
-	resource_t *rsc = pe_find_resource(data_set->resources, rsc_id);
+	resource_t *rsc = pe_lookup_resource(data_set, rsc_id);
 
 	if(rsc == NULL) {
 		CMD_ERR("Resource %s not found\n", rsc_id);
@@ -956,7 +956,7 @@ list_resource_operations(
 	       const char *status_s = crm_element_value(xml_op, XML_LRM_ATTR_OPSTATUS);
 	       int status = crm_parse_int(status_s, "0");
 
-	       rsc = pe_find_resource(data_set->resources, op_rsc);
+	       rsc = pe_lookup_resource(data_set, op_rsc);
 	       rsc->fns->print(rsc, "", opts, stdout);
 	       
 	       fprintf(stdout, ": %s (node=%s, call=%s, rc=%s",
@@ -1324,7 +1324,7 @@ main(int argc, char **argv)
 	    }
 		
 	} else if(rsc_cmd == 'A') {
-	    resource_t *rsc = pe_find_resource(data_set.resources, rsc_id);
+	    resource_t *rsc = pe_lookup_resource(&data_set, rsc_id);
 	    xmlNode * cib_constraints = get_object_root(XML_CIB_TAG_CONSTRAINTS, data_set.input);
 	    if(rsc == NULL) {
 		CMD_ERR("Must supply a resource id with -r\n");
@@ -1338,7 +1338,7 @@ main(int argc, char **argv)
 	    show_colocation(rsc, FALSE, FALSE);
 	    
 	} else if(rsc_cmd == 'a') {
-	    resource_t *rsc = pe_find_resource(data_set.resources, rsc_id);
+	    resource_t *rsc = pe_lookup_resource(&data_set, rsc_id);
 	    xmlNode * cib_constraints = get_object_root(XML_CIB_TAG_CONSTRAINTS, data_set.input);
 	    if(rsc == NULL) {
 		CMD_ERR("Must supply a resource id with -r\n");
@@ -1364,7 +1364,7 @@ main(int argc, char **argv)
 	    print_cts_constraints(&data_set);
 		
 	} else if(rsc_cmd == 'C') {
-	    resource_t *rsc = pe_find_resource(data_set.resources, rsc_id);
+	    resource_t *rsc = pe_lookup_resource(&data_set, rsc_id);
 	    rc = delete_lrm_rsc(crmd_channel, host_uname, rsc, &data_set);
 	    if(rc == cib_ok) {
 		start_mainloop();
@@ -1411,7 +1411,7 @@ main(int argc, char **argv)
 		node_t *dest = NULL;
 		node_t *current = NULL;
 		const char *current_uname = NULL;
-		resource_t *rsc = pe_find_resource(data_set.resources, rsc_id);
+		resource_t *rsc = pe_lookup_resource(&data_set, rsc_id);
 		if(rsc != NULL && rsc->running_on != NULL) {
 			current = rsc->running_on->data;
 			if(current != NULL) {
@@ -1420,7 +1420,7 @@ main(int argc, char **argv)
 		}
 
 		if(host_uname != NULL) {
-			dest = pe_find_node(data_set.nodes, host_uname);
+			dest = pe_lookup_node(&data_set, host_uname);
 		}
 		
 		if(rsc == NULL) {